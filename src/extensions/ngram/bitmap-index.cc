@@ -18,12 +18,19 @@
 #include <fst/extensions/ngram/bitmap-index.h>
 
 #include <algorithm>
-#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__AVX512VPOPCNTDQ__) || \
+    defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <fst/log.h>
 #include <fst/extensions/ngram/nthbit.h>
 
@@ -32,69 +39,200 @@ namespace fst {
 static_assert(sizeof(long long) >= sizeof(uint64_t),  // NOLINT
               "__builtin_...ll is used on uint64_t values.");
 
-constexpr std::array<uint64_t, 64> LowBitsMasks() {
-  std::array<uint64_t, 64> m{};
-  for (int i = 0; i < 64; ++i) m[i] = (uint64_t{1} << i) - 1;
-  return m;
+namespace {
+
+// Per-block popcount for BuildIndex: counts[k] = popcount(word[k]) over an
+// 8-word (512-bit) block. The implementation is picked once per process so
+// default builds still use the widest instruction set the host supports,
+// without requiring -mavx2 / -mavx512vpopcntdq at compile time.
+using PopcountBlockFn = void (*)(const uint64_t word[8], uint32_t counts[8]);
+
+[[maybe_unused]] void PopcountBlockScalar(const uint64_t word[8],
+                                          uint32_t counts[8]) {
+  for (int k = 0; k < 8; ++k) counts[k] = __builtin_popcountll(word[k]);
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+// Popcount the whole block with a single VPOPCNTQ: one load and one
+// instruction replace 8 scalar loads and popcounts.
+__attribute__((target("avx512f,avx512vpopcntdq"))) void PopcountBlockVpopcntdq(
+    const uint64_t word[8], uint32_t counts[8]) {
+  const __m512i v = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(word));
+  // Sparse n-gram bitmaps have long all-zero runs; one mask test skips
+  // the popcount and the vector-to-scalar store round trip for those
+  // blocks.
+  if (_mm512_test_epi64_mask(v, v) == 0) {
+    for (int k = 0; k < 8; ++k) counts[k] = 0;
+    return;
+  }
+  alignas(64) uint64_t lane_counts[8];
+  _mm512_store_si512(reinterpret_cast<__m512i*>(lane_counts),
+                     _mm512_popcnt_epi64(v));
+  for (int k = 0; k < 8; ++k) counts[k] = lane_counts[k];
+}
+
+// AVX2 fallback: Muła's PSHUFB nibble-LUT popcount. VPSADBW against zero
+// sums the byte popcounts within each 64-bit lane, which is exactly the
+// per-word count the relative counters need, so no scalar second pass is
+// required. Two 256-bit vectors cover the 8-word block. This sidesteps the
+// scalar POPCNT false-dependency stall and issues 4 words per shuffle/add
+// sequence.
+__attribute__((target("avx2"))) void PopcountBlockAvx2(const uint64_t word[8],
+                                                       uint32_t counts[8]) {
+  const __m256i nibble_lut = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,  //
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+  alignas(32) uint64_t lane_counts[8];
+  for (int half = 0; half < 2; ++half) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word + 4 * half));
+    const __m256i lo = _mm256_and_si256(v, low_nibbles);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), low_nibbles);
+    const __m256i byte_counts =
+        _mm256_add_epi8(_mm256_shuffle_epi8(nibble_lut, lo),
+                        _mm256_shuffle_epi8(nibble_lut, hi));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_counts + 4 * half),
+                       _mm256_sad_epu8(byte_counts, _mm256_setzero_si256()));
+  }
+  for (int k = 0; k < 8; ++k) counts[k] = lane_counts[k];
+}
+
+PopcountBlockFn ResolvePopcountBlock() {
+  if (__builtin_cpu_supports("avx512vpopcntdq")) return &PopcountBlockVpopcntdq;
+  if (__builtin_cpu_supports("avx2")) return &PopcountBlockAvx2;
+  return &PopcountBlockScalar;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+// NEON path: CNT counts bits per byte, then pairwise ADDV reductions over
+// each 8-byte half give the per-word counts. Four 16-byte loads cover the
+// block. ASIMD is baseline on AArch64, so no runtime detection is needed.
+void PopcountBlockNeon(const uint64_t word[8], uint32_t counts[8]) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(word);
+  for (int pair = 0; pair < 4; ++pair) {
+    const uint8x16_t byte_counts = vcntq_u8(vld1q_u8(bytes + 16 * pair));
+    counts[2 * pair] = vaddv_u8(vget_low_u8(byte_counts));
+    counts[2 * pair + 1] = vaddv_u8(vget_high_u8(byte_counts));
+  }
+}
+
+PopcountBlockFn ResolvePopcountBlock() { return &PopcountBlockNeon; }
+
+#else
+
+PopcountBlockFn ResolvePopcountBlock() { return &PopcountBlockScalar; }
+
+#endif  // __x86_64__
+
+// Branchless std::upper_bound over [begin, begin + n): returns a pointer to
+// the first element > value. Each step halves the range with a compare and
+// a conditional add that compile to cmov, so random queries pay no branch
+// mispredictions, unlike the data-dependent branch per step in the library
+// binary search.
+inline const uint32_t* BranchlessUpperBound(const uint32_t* begin, size_t n,
+                                            uint32_t value) {
+  while (n > 1) {
+    const size_t half = n / 2;
+    if (n > 16) {
+      // Both possible midpoints of the next iteration are known before
+      // this iteration's compare resolves; start their loads now so the
+      // next step's (potential) miss overlaps with this one. Pointless
+      // once the range fits in a cache line (16 keys).
+      __builtin_prefetch(&begin[(n - half) / 2], /*rw=*/0, /*locality=*/0);
+      __builtin_prefetch(&begin[half + (n - half) / 2], /*rw=*/0,
+                         /*locality=*/0);
+    }
+    begin += begin[half] <= value ? half : 0;
+    n -= half;
+  }
+  return begin + (*begin <= value);
+}
+
+}  // namespace
+
+uint32_t BitmapIndex::SelectOnesWordInBlock(const RankIndexEntry& entry,
+                                            uint32_t* rembits) {
+  const uint32_t r = *rembits;
+  // Largest word whose preceding-ones count is <= r; each step is a
+  // compare + conditional add that compiles to cmov.
+  uint32_t word = r >= entry.relative_ones_count_4() ? 4 : 0;
+  word += r >= entry.relative_ones_count(word + 2) ? 2 : 0;
+  word += r >= entry.relative_ones_count(word + 1) ? 1 : 0;
+  *rembits = r - entry.relative_ones_count(word);
+  return word;
+}
+
+uint32_t BitmapIndex::SelectZerosWordInBlock(const uint16_t* zeros_counts,
+                                             uint32_t* rembits) {
+  const uint32_t r = *rembits;
+  // Same cmov descent as the ones side, over the precomputed
+  // zeros-before-word thresholds.
+  uint32_t word = r >= zeros_counts[4] ? 4 : 0;
+  word += r >= zeros_counts[word + 2] ? 2 : 0;
+  word += r >= zeros_counts[word + 1] ? 1 : 0;
+  *rembits = r - zeros_counts[word];
+  return word;
 }
-constexpr std::array<uint64_t, 64> kLowBitsMasks = LowBitsMasks();
 
 size_t BitmapIndex::Rank1(size_t end) const {
   DFST_CHECK_LE(end, Bits());
   // TODO(jrosenstock): Remove nullptr support and this special case.
-  if (end == 0) return 0;
+  if (__builtin_expect(end == 0, false)) return 0;
   // Without this special case, we'd go past the end. It's questionable
   // whether we should support end == Bits().
-  if (end >= num_bits_) return GetOnesCount();
+  if (__builtin_expect(end >= num_bits_, false)) return GetOnesCount();
   const uint32_t end_word = end / kStorageBitSize;
+  // The index entry and the payload word live on different cache lines;
+  // start the payload load before the index lookup so the two (potential)
+  // misses overlap instead of serializing.
+  __builtin_prefetch(&bits_[end_word], /*rw=*/0, /*locality=*/3);
   const uint32_t sum = GetIndexOnesCount(end_word);
   const int bit_index = end % kStorageBitSize;
   // TODO(jrosenstock): better with or without special case, and does
   // this depend on whether there's a popcnt instruction?
   if (bit_index == 0) return sum;  // Entire answer is in the index.
-  return sum + __builtin_popcountll(bits_[end_word] & kLowBitsMasks[bit_index]);
+  // Materialize the low-bits mask in a register (BZHI does it in one
+  // instruction) instead of loading it from a lookup table.
+#if defined(__BMI2__)
+  return sum + __builtin_popcountll(_bzhi_u64(bits_[end_word], bit_index));
+#else
+  return sum + __builtin_popcountll(bits_[end_word] &
+                                    ((uint64_t{1} << bit_index) - 1));
+#endif
+}
+
+void BitmapIndex::Rank1Batch(const size_t* ends, size_t n, size_t* out) const {
+  // Software pipelining: start the index and payload loads for a later
+  // query while answering the current one, so the (up to) two cache
+  // misses per query overlap across the stream instead of serializing.
+  // A depth of 8 covers DRAM latency at a few cycles per query.
+  constexpr size_t kPrefetchAhead = 8;
+  for (size_t i = 0; i < n; ++i) {
+    if (i + kPrefetchAhead < n) {
+      const size_t ahead_word = ends[i + kPrefetchAhead] / kStorageBitSize;
+      __builtin_prefetch(&bits_[ahead_word], /*rw=*/0, /*locality=*/3);
+      __builtin_prefetch(
+          &absolute_ones_counts_[ahead_word / kUnitsPerRankIndexEntry],
+          /*rw=*/0, /*locality=*/3);
+    }
+    out[i] = Rank1(ends[i]);
+  }
 }
 
 size_t BitmapIndex::Select1(size_t bit_index) const {
-  if (bit_index >= GetOnesCount()) return Bits();
-  const RankIndexEntry& entry = FindRankIndexEntry(bit_index);
-  const uint32_t block_index = &entry - rank_index_.data();
+  if (__builtin_expect(bit_index >= GetOnesCount(), false)) return Bits();
+  const uint32_t block_index = FindRankIndexEntry(bit_index);
+  const RankIndexEntry& entry = rank_index_[block_index];
   // TODO(jrosenstock): Look at whether word or bit indices are faster.
   static_assert(kUnitsPerRankIndexEntry == 8);
   uint32_t word_index = block_index * kUnitsPerRankIndexEntry;
 
   // Find position within this block.
-  uint32_t rembits = bit_index - entry.absolute_ones_count();
-  if (rembits < entry.relative_ones_count_4()) {
-    if (rembits < entry.relative_ones_count_2()) {
-      if (rembits < entry.relative_ones_count_1()) {
-        // First word, nothing to do.
-      } else {
-        word_index += 1;
-        rembits -= entry.relative_ones_count_1();
-      }
-    } else if (rembits < entry.relative_ones_count_3()) {
-      word_index += 2;
-      rembits -= entry.relative_ones_count_2();
-    } else {
-      word_index += 3;
-      rembits -= entry.relative_ones_count_3();
-    }
-  } else if (rembits < entry.relative_ones_count_6()) {
-    if (rembits < entry.relative_ones_count_5()) {
-      word_index += 4;
-      rembits -= entry.relative_ones_count_4();
-    } else {
-      word_index += 5;
-      rembits -= entry.relative_ones_count_5();
-    }
-  } else if (rembits < entry.relative_ones_count_7()) {
-    word_index += 6;
-    rembits -= entry.relative_ones_count_6();
-  } else {
-    word_index += 7;
-    rembits -= entry.relative_ones_count_7();
-  }
+  uint32_t rembits = bit_index - absolute_ones_counts_[block_index];
+  word_index += SelectOnesWordInBlock(entry, &rembits);
 
   const int nth = nth_bit(bits_[word_index], rembits);
   return kStorageBitSize * word_index + nth;
@@ -102,46 +240,18 @@ size_t BitmapIndex::Select1(size_t bit_index) const {
 
 size_t BitmapIndex::Select0(size_t bit_index) const {
   const uint32_t zeros_count = Bits() - GetOnesCount();
-  if (bit_index >= zeros_count) return Bits();
-  const RankIndexEntry& entry = FindInvertedRankIndexEntry(bit_index);
-  const uint32_t block_index = &entry - rank_index_.data();
+  if (__builtin_expect(bit_index >= zeros_count, false)) return Bits();
+  const uint32_t block_index = FindInvertedRankIndexEntry(bit_index);
   static_assert(kUnitsPerRankIndexEntry == 8);
   uint32_t word_index = block_index * kUnitsPerRankIndexEntry;
 
   // Find position within this block.
   uint32_t entry_zeros_count =
-      kStorageBitSize * word_index - entry.absolute_ones_count();
+      kStorageBitSize * word_index - absolute_ones_counts_[block_index];
   uint32_t remzeros = bit_index - entry_zeros_count;
-  if (remzeros < 4 * kStorageBitSize - entry.relative_ones_count_4()) {
-    if (remzeros < 2 * kStorageBitSize - entry.relative_ones_count_2()) {
-      if (remzeros < kStorageBitSize - entry.relative_ones_count_1()) {
-        // Nothing to do.
-      } else {
-        word_index += 1;
-        remzeros -= kStorageBitSize - entry.relative_ones_count_1();
-      }
-    } else if (remzeros < 3 * kStorageBitSize - entry.relative_ones_count_3()) {
-      word_index += 2;
-      remzeros -= 2 * kStorageBitSize - entry.relative_ones_count_2();
-    } else {
-      word_index += 3;
-      remzeros -= 3 * kStorageBitSize - entry.relative_ones_count_3();
-    }
-  } else if (remzeros < 6 * kStorageBitSize - entry.relative_ones_count_6()) {
-    if (remzeros < 5 * kStorageBitSize - entry.relative_ones_count_5()) {
-      word_index += 4;
-      remzeros -= 4 * kStorageBitSize - entry.relative_ones_count_4();
-    } else {
-      word_index += 5;
-      remzeros -= 5 * kStorageBitSize - entry.relative_ones_count_5();
-    }
-  } else if (remzeros < 7 * kStorageBitSize - entry.relative_ones_count_7()) {
-    word_index += 6;
-    remzeros -= 6 * kStorageBitSize - entry.relative_ones_count_6();
-  } else {
-    word_index += 7;
-    remzeros -= 7 * kStorageBitSize - entry.relative_ones_count_7();
-  }
+  word_index += SelectZerosWordInBlock(
+      &relative_zeros_counts_[block_index * kUnitsPerRankIndexEntry],
+      &remzeros);
 
   const int nth = nth_bit(~bits_[word_index], remzeros);
   return kStorageBitSize * word_index + nth;
@@ -149,47 +259,23 @@ size_t BitmapIndex::Select0(size_t bit_index) const {
 
 std::pair<size_t, size_t> BitmapIndex::Select0s(size_t bit_index) const {
   const uint32_t zeros_count = Bits() - GetOnesCount();
-  if (bit_index >= zeros_count) return {Bits(), Bits()};
-  if (bit_index + 1 >= zeros_count) return {Select0(bit_index), Bits()};
+  if (__builtin_expect(bit_index >= zeros_count, false)) {
+    return {Bits(), Bits()};
+  }
+  if (__builtin_expect(bit_index + 1 >= zeros_count, false)) {
+    return {Select0(bit_index), Bits()};
+  }
 
-  const RankIndexEntry& entry = FindInvertedRankIndexEntry(bit_index);
-  const uint32_t block_index = &entry - rank_index_.data();
+  const uint32_t block_index = FindInvertedRankIndexEntry(bit_index);
   uint32_t word_index = block_index * kUnitsPerRankIndexEntry;
 
   // Find position within this block.
   uint32_t entry_zeros_count =
-      kStorageBitSize * word_index - entry.absolute_ones_count();
+      kStorageBitSize * word_index - absolute_ones_counts_[block_index];
   uint32_t remzeros = bit_index - entry_zeros_count;
-  if (remzeros < 4 * kStorageBitSize - entry.relative_ones_count_4()) {
-    if (remzeros < 2 * kStorageBitSize - entry.relative_ones_count_2()) {
-      if (remzeros < kStorageBitSize - entry.relative_ones_count_1()) {
-        // Nothing to do.
-      } else {
-        word_index += 1;
-        remzeros -= kStorageBitSize - entry.relative_ones_count_1();
-      }
-    } else if (remzeros < 3 * kStorageBitSize - entry.relative_ones_count_3()) {
-      word_index += 2;
-      remzeros -= 2 * kStorageBitSize - entry.relative_ones_count_2();
-    } else {
-      word_index += 3;
-      remzeros -= 3 * kStorageBitSize - entry.relative_ones_count_3();
-    }
-  } else if (remzeros < 6 * kStorageBitSize - entry.relative_ones_count_6()) {
-    if (remzeros < 5 * kStorageBitSize - entry.relative_ones_count_5()) {
-      word_index += 4;
-      remzeros -= 4 * kStorageBitSize - entry.relative_ones_count_4();
-    } else {
-      word_index += 5;
-      remzeros -= 5 * kStorageBitSize - entry.relative_ones_count_5();
-    }
-  } else if (remzeros < 7 * kStorageBitSize - entry.relative_ones_count_7()) {
-    word_index += 6;
-    remzeros -= 6 * kStorageBitSize - entry.relative_ones_count_6();
-  } else {
-    word_index += 7;
-    remzeros -= 7 * kStorageBitSize - entry.relative_ones_count_7();
-  }
+  word_index += SelectZerosWordInBlock(
+      &relative_zeros_counts_[block_index * kUnitsPerRankIndexEntry],
+      &remzeros);
 
   // Find the position of the bit_index-th zero.
   const uint64_t inv_word = ~bits_[word_index];
@@ -208,26 +294,32 @@ std::pair<size_t, size_t> BitmapIndex::Select0s(size_t bit_index) const {
   const uint64_t masked_inv_word = inv_word & mask;
 
   // If this is 0, then the next zero is not in the same word.
-  if (masked_inv_word != 0) {
+  if (__builtin_expect(masked_inv_word != 0, true)) {
     // We can't ctz on 0, but we already checked that.
     const int next_nth = __builtin_ctzll(masked_inv_word);
     return {kStorageBitSize * word_index + nth,
             kStorageBitSize * word_index + next_nth};
-  } else {
-    // TODO(jrosenstock): Try other words in the block.
-    // This should not be massively important. With a bit density of 1/2,
-    // 31/32 zeros in a word have the next zero in the same word.
-    return {kStorageBitSize * word_index + nth, Select0(bit_index + 1)};
   }
-}
 
-uint32_t BitmapIndex::GetIndexOnesCount(size_t array_index) const {
-  const auto& rank_index_entry =
-      rank_index_[array_index / kUnitsPerRankIndexEntry];
-  uint32_t ones_count = rank_index_entry.absolute_ones_count();
-  static_assert(kUnitsPerRankIndexEntry == 8);
-  return ones_count + rank_index_entry.relative_ones_count(
-                          array_index % kUnitsPerRankIndexEntry);
+  // With a bit density of 1/2, 31/32 zeros in a word have the next zero in
+  // the same word. For most of the rest, the next zero is in a later word
+  // of the same block, whose words are already cache-resident from the
+  // lookups above, so scan those before paying for a full Select0 restart.
+  // A padding zero past num_bits_ can't be found here: the range check at
+  // the top guarantees an in-range zero after the current one.
+  const size_t block_word_end =
+      std::min<size_t>((block_index + 1) * kUnitsPerRankIndexEntry,
+                       ArraySize());
+  for (uint32_t w = word_index + 1; w < block_word_end; ++w) {
+    const uint64_t inv = ~bits_[w];
+    if (inv != 0) {
+      return {kStorageBitSize * word_index + nth,
+              kStorageBitSize * w + __builtin_ctzll(inv)};
+    }
+  }
+
+  // The rest of the block is all ones; restart for the next zero.
+  return {kStorageBitSize * word_index + nth, Select0(bit_index + 1)};
 }
 
 void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
@@ -241,6 +333,10 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
   num_bits_ = num_bits;
   rank_index_.clear();
   rank_index_.resize(rank_index_size());
+  absolute_ones_counts_.clear();
+  absolute_ones_counts_.resize(rank_index_size());
+  relative_zeros_counts_.clear();
+  relative_zeros_counts_.resize(rank_index_size() * kUnitsPerRankIndexEntry);
 
   select_0_index_.clear();
   if (enable_select_0_index) {
@@ -253,6 +349,8 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
     select_1_index_.reserve(num_bits / (2 * kBitsPerSelect1Block) + 1);
   }
 
+  static const PopcountBlockFn popcount_block = ResolvePopcountBlock();
+
   const size_t kArraySize = ArraySize();
   uint32_t ones_count = 0;
   uint32_t zeros_count = 0;
@@ -268,34 +366,58 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
         (word_index + 7 < kArraySize) ? bits[word_index + 7] : 0,
     };
 
-    const int word_ones_count[8] = {
-        __builtin_popcountll(word[0]), __builtin_popcountll(word[1]),
-        __builtin_popcountll(word[2]), __builtin_popcountll(word[3]),
-        __builtin_popcountll(word[4]), __builtin_popcountll(word[5]),
-        __builtin_popcountll(word[6]), __builtin_popcountll(word[7]),
-    };
+    uint32_t word_ones_count[8];
+    popcount_block(word, word_ones_count);
 
     auto& rank_index_entry = rank_index_[word_index / kUnitsPerRankIndexEntry];
     const uint32_t abs_ones_count = ones_count;
-    rank_index_entry.set_absolute_ones_count(abs_ones_count);
-    ones_count += word_ones_count[0];
-    rank_index_entry.set_relative_ones_count_1(ones_count - abs_ones_count);
-    ones_count += word_ones_count[1];
-    rank_index_entry.set_relative_ones_count_2(ones_count - abs_ones_count);
-    ones_count += word_ones_count[2];
-    rank_index_entry.set_relative_ones_count_3(ones_count - abs_ones_count);
-    ones_count += word_ones_count[3];
-    rank_index_entry.set_relative_ones_count_4(ones_count - abs_ones_count);
-    ones_count += word_ones_count[4];
-    rank_index_entry.set_relative_ones_count_5(ones_count - abs_ones_count);
-    ones_count += word_ones_count[5];
-    rank_index_entry.set_relative_ones_count_6(ones_count - abs_ones_count);
-    ones_count += word_ones_count[6];
-    rank_index_entry.set_relative_ones_count_7(ones_count - abs_ones_count);
-    ones_count += word_ones_count[7];
+    absolute_ones_counts_[word_index / kUnitsPerRankIndexEntry] =
+        abs_ones_count;
+
+    // Exclusive prefix sums over the per-word popcounts. The rank entry
+    // and both select scans below all need these running counts; computing
+    // them once here keeps the select scans free of serial accumulation,
+    // so their per-word iterations are independent.
+    uint32_t cum_ones[9];
+    cum_ones[0] = 0;
+#if defined(__AVX2__)
+    {
+      // Hillis-Steele parallel prefix: three shift-and-add steps replace
+      // the 8-deep serial add chain. The first two steps run within each
+      // 128-bit half; the third adds the low half's total to the high half.
+      __m256i x = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(word_ones_count));
+      x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+      x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+      __m256i low_total = _mm256_permute2x128_si256(x, x, 0x08);
+      low_total = _mm256_shuffle_epi32(low_total, 0xFF);
+      x = _mm256_add_epi32(x, low_total);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cum_ones + 1), x);
+    }
+#else
+    for (int i = 0; i < 8; ++i) {
+      cum_ones[i + 1] = cum_ones[i] + word_ones_count[i];
+    }
+#endif  // __AVX2__
+
+    rank_index_entry.set_relative_ones_count_1(cum_ones[1]);
+    rank_index_entry.set_relative_ones_count_2(cum_ones[2]);
+    rank_index_entry.set_relative_ones_count_3(cum_ones[3]);
+    rank_index_entry.set_relative_ones_count_4(cum_ones[4]);
+    rank_index_entry.set_relative_ones_count_5(cum_ones[5]);
+    rank_index_entry.set_relative_ones_count_6(cum_ones[6]);
+    rank_index_entry.set_relative_ones_count_7(cum_ones[7]);
+    ones_count += cum_ones[8];
+
+    // Inverted thresholds for Select0's within-block descent.
+    uint16_t* zeros_counts =
+        &relative_zeros_counts_[word_index / kUnitsPerRankIndexEntry *
+                                kUnitsPerRankIndexEntry];
+    for (int i = 0; i < 8; ++i) {
+      zeros_counts[i] = i * kStorageBitSize - cum_ones[i];
+    }
 
     if (enable_select_0_index) {
-      int s0_zeros_count = zeros_count;
       for (int i = 0; i < 8; ++i) {
         const size_t bit_offset = (word_index + i) * kStorageBitSize;
         if (bit_offset >= num_bits_) break;
@@ -303,7 +425,9 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
         // Zeros count is somewhat more involved to compute, so only do it
         // if we need it. The last word has zeros in the high bits, so
         // that needs to be accounted for when computing the zeros count
-        // from the ones count.
+        // from the ones count. Words before a partial word are always
+        // full, so the zeros preceding word i within the block are
+        // i * kStorageBitSize - cum_ones[i].
         const uint32_t bits_remaining = num_bits - bit_offset;
         const int word_zeros_count =
             std::min(bits_remaining, kStorageBitSize) - word_ones_count[i];
@@ -313,6 +437,8 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
         // zeros_count is 1 mod kBitsPerSelect0Block, we need to skip
         // kBitsPerSelect0Block - 1 zeros, then record a zero. And so on.
         // What function is this?  It's -zeros_count % kBitsPerSelect0Block.
+        const uint32_t s0_zeros_count =
+            zeros_count + i * kStorageBitSize - cum_ones[i];
         const uint32_t zeros_to_skip = -s0_zeros_count % kBitsPerSelect0Block;
         if (word_zeros_count > zeros_to_skip) {
           const int nth = nth_bit(~word[i], zeros_to_skip);
@@ -321,16 +447,15 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
                         "kBitsPerSelect0Block must be at least 512.");
           break;  // 8 entries is 512 bits, so we can't push another bit here.
         }
-        s0_zeros_count += word_zeros_count;
       }
-      zeros_count += 8 * kStorageBitSize - (ones_count - abs_ones_count);
+      zeros_count += 8 * kStorageBitSize - cum_ones[8];
     }
 
     if (enable_select_1_index) {
-      int s1_ones_count = abs_ones_count;
       for (int i = 0; i < 8; ++i) {
         const size_t bit_offset = (word_index + i) * kStorageBitSize;
-        uint32_t ones_to_skip = -s1_ones_count % kBitsPerSelect1Block;
+        const uint32_t ones_to_skip =
+            -(abs_ones_count + cum_ones[i]) % kBitsPerSelect1Block;
         if (word_ones_count[i] > ones_to_skip) {
           const int nth = nth_bit(word[i], ones_to_skip);
           select_1_index_.push_back(bit_offset + nth);
@@ -338,12 +463,15 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
                         "kBitsPerSelect1Block must be at least 512.");
           break;  // 8 entries is 512 bits, so we can't push another bit here.
         }
-        s1_ones_count += word_ones_count[i];
       }
     }
   }
-  // Add the extra entry with the total number of bits.
-  rank_index_.back().set_absolute_ones_count(ones_count);
+  // Add the extra entry with the total number of bits, then the sentinel
+  // padding for the vectorized linear scan in FindRankIndexEntry.
+  absolute_ones_counts_.back() = ones_count;
+  absolute_ones_counts_.resize(rank_index_size() + kAbsoluteCountsPadding,
+                               UINT32_MAX);
+  total_ones_ = ones_count;
 
   if (enable_select_0_index) {
     // Add extra entry with num_bits_.
@@ -357,16 +485,15 @@ void BitmapIndex::BuildIndex(const uint64_t* bits, size_t num_bits,
   }
 }
 
-const BitmapIndex::RankIndexEntry& BitmapIndex::FindRankIndexEntry(
-    size_t bit_index) const {
+uint32_t BitmapIndex::FindRankIndexEntry(size_t bit_index) const {
   DFST_CHECK_GE(bit_index, 0);
-  DFST_CHECK_LT(bit_index, rank_index_.back().absolute_ones_count());
+  DFST_CHECK_LT(bit_index, GetOnesCount());
 
-  const RankIndexEntry* begin = nullptr;
-  const RankIndexEntry* end = nullptr;
+  const uint32_t* begin = nullptr;
+  const uint32_t* end = nullptr;
   if (select_1_index_.empty()) {
-    begin = &rank_index_[0];
-    end = begin + rank_index_.size();
+    begin = absolute_ones_counts_.data();
+    end = begin + rank_index_size();
   } else {
     const uint32_t select_index = bit_index / kBitsPerSelect1Block;
     DFST_CHECK_LT(select_index + 1, select_1_index_.size());
@@ -381,38 +508,53 @@ const BitmapIndex::RankIndexEntry& BitmapIndex::FindRankIndexEntry(
     const uint32_t lo_bit_index = select_1_index_[select_index];
     const uint32_t hi_bit_index = select_1_index_[select_index + 1];
 
-    begin = &rank_index_[lo_bit_index / kBitsPerSelect1Block];
-    end = &rank_index_[(hi_bit_index + kBitsPerSelect1Block - 1) /
-                       kBitsPerSelect1Block];
+    begin = &absolute_ones_counts_[lo_bit_index / kBitsPerSelect1Block];
+    end = &absolute_ones_counts_[(hi_bit_index + kBitsPerSelect1Block - 1) /
+                                 kBitsPerSelect1Block];
   }
 
   // Linear search if the range is small.
-  const RankIndexEntry* entry = nullptr;
+  const uint32_t* entry = nullptr;
   if (end - begin <= kMaxLinearSearchBlocks) {
+#if defined(__AVX2__)
+    // Vector compares cover the linear range 8 keys at a time, replacing
+    // the mispredicting early-exit loop; the per-vector "any lane hit"
+    // branch fires at most once, which is what lets the linear threshold
+    // be 4x larger than the scalar one. Loading a full 8 lanes may read
+    // past `end`, but stays inside the array thanks to the sentinel
+    // padding, and the sentinels can never win because the answer
+    // precedes `end`. XORing the sign bit turns the signed lane compare
+    // into the unsigned compare the counts require.
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i needle = _mm256_xor_si256(
+        _mm256_set1_epi32(static_cast<int32_t>(bit_index)), sign);
+    for (const uint32_t* p = begin;; p += 8) {
+      const __m256i keys = _mm256_xor_si256(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), sign);
+      const int gt = _mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpgt_epi32(keys, needle)));
+      if (gt != 0) {
+        entry = p + __builtin_ctz(gt);
+        break;
+      }
+    }
+#else
     for (entry = begin; entry != end; ++entry) {
-      if (entry->absolute_ones_count() > bit_index) break;
+      if (*entry > bit_index) break;
     }
+#endif  // __AVX2__
   } else {
-    RankIndexEntry search_entry;
-    search_entry.set_absolute_ones_count(bit_index);
-    // TODO(jrosenstock): benchmark upper vs custom bsearch.
-    entry = &*std::upper_bound(
-        begin, end, search_entry,
-        [](const RankIndexEntry& e1, const RankIndexEntry& e2) {
-          return e1.absolute_ones_count() < e2.absolute_ones_count();
-        });
+    entry = BranchlessUpperBound(begin, end - begin, bit_index);
   }
 
-  const auto& e = *(entry - 1);
-  DFST_CHECK_LE(e.absolute_ones_count(), bit_index);
-  DFST_CHECK_GT(entry->absolute_ones_count(), bit_index);
-  return e;
+  DFST_CHECK_LE(*(entry - 1), bit_index);
+  DFST_CHECK_GT(*entry, bit_index);
+  return (entry - 1) - absolute_ones_counts_.data();
 }
 
-const BitmapIndex::RankIndexEntry& BitmapIndex::FindInvertedRankIndexEntry(
-    size_t bit_index) const {
+uint32_t BitmapIndex::FindInvertedRankIndexEntry(size_t bit_index) const {
   DFST_CHECK_GE(bit_index, 0);
-  DFST_CHECK_LT(bit_index, num_bits_ - rank_index_.back().absolute_ones_count());
+  DFST_CHECK_LT(bit_index, num_bits_ - GetOnesCount());
 
   uint32_t lo = 0, hi = 0;
   if (select_0_index_.empty()) {
@@ -429,31 +571,46 @@ const BitmapIndex::RankIndexEntry& BitmapIndex::FindInvertedRankIndexEntry(
          kBitsPerSelect0Block;
   }
 
-  DFST_CHECK_LT(hi, rank_index_.size());
+  DFST_CHECK_LT(hi, absolute_ones_counts_.size());
   // Linear search never showed an advantage when benchmarking. This may be
   // because the linear search is more complex with the zeros_count computation,
   // or because the ranges are larger, so linear search is triggered less often,
   // and the difference is harder to measure.
-  while (lo + 1 < hi) {
-    const uint32_t mid = lo + (hi - lo) / 2;
-    if (bit_index <
-        kBitsPerRankIndexEntry * mid - rank_index_[mid].absolute_ones_count()) {
-      hi = mid;
-    } else {
-      lo = mid;
+  //
+  // Branchless binary search for the last block whose preceding-zeros
+  // count is <= bit_index: as in BranchlessUpperBound, each halving step
+  // is a compare plus a conditional add that compiles to cmov, so random
+  // queries pay no branch mispredictions. The zeros count of block i is
+  // derived on the fly as i * 512 - absolute_ones_counts_[i].
+  uint32_t n = hi - lo;
+  while (n > 1) {
+    const uint32_t half = n / 2;
+    const uint32_t probe = lo + half;
+    if (n > 16) {
+      // Start the loads for both possible next midpoints (see
+      // BranchlessUpperBound).
+      __builtin_prefetch(&absolute_ones_counts_[lo + (n - half) / 2],
+                         /*rw=*/0, /*locality=*/0);
+      __builtin_prefetch(&absolute_ones_counts_[probe + (n - half) / 2],
+                         /*rw=*/0, /*locality=*/0);
     }
+    lo += kBitsPerRankIndexEntry * probe - absolute_ones_counts_[probe] <=
+                  bit_index
+              ? half
+              : 0;
+    n -= half;
   }
 
-  DFST_CHECK_LE(lo * kBitsPerRankIndexEntry - rank_index_[lo].absolute_ones_count(),
+  DFST_CHECK_LE(lo * kBitsPerRankIndexEntry - absolute_ones_counts_[lo],
             bit_index);
   if ((lo + 1) * kBitsPerRankIndexEntry <= num_bits_) {
     DFST_CHECK_GT((lo + 1) * kBitsPerRankIndexEntry -
-                  rank_index_[lo + 1].absolute_ones_count(),
+                  absolute_ones_counts_[lo + 1],
               bit_index);
   } else {
-    DFST_CHECK_GT(num_bits_ - rank_index_[lo + 1].absolute_ones_count(), bit_index);
+    DFST_CHECK_GT(num_bits_ - absolute_ones_counts_[lo + 1], bit_index);
   }
-  return rank_index_[lo];
+  return lo;
 }
 
 }  // end namespace fst
@@ -27,6 +27,7 @@
 #include <cstdint>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include <fst/arc-map.h>
@@ -187,6 +188,31 @@ class ArcIterator<ArcSortFst<Arc, Compare>>
                                                                         s) {}
 };
 
+namespace internal {
+
+// True when Label is a signed integer no wider than 32 bits, in which case
+// the packed-key comparison below is order-equivalent to the lexicographic
+// tuple comparison of a label pair.
+template <class Arc>
+inline constexpr bool kPackedLabelCompare =
+    std::is_integral_v<typename Arc::Label> &&
+    std::is_signed_v<typename Arc::Label> &&
+    sizeof(typename Arc::Label) <= sizeof(int32_t);
+
+// Packs a label pair into one 64-bit key whose unsigned order matches the
+// lexicographic order of (major, minor): flipping the sign bits maps
+// two's-complement order onto unsigned order. Comparing keys takes a single
+// branch-free integer compare, where the tuple comparison short-circuits on
+// the first component and so branches per element inside the sort.
+template <class Label>
+constexpr uint64_t LabelPairSortKey(Label major, Label minor) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(major) ^ 0x80000000u)
+          << 32) |
+         (static_cast<uint32_t>(minor) ^ 0x80000000u);
+}
+
+}  // namespace internal
+
 // Compare class for comparing input labels of arcs.
 template <class Arc>
 class ILabelCompare {
@@ -194,8 +220,13 @@ class ILabelCompare {
   constexpr ILabelCompare() = default;
 
   constexpr bool operator()(const Arc &lhs, const Arc &rhs) const {
-    return std::forward_as_tuple(lhs.ilabel, lhs.olabel) <
-           std::forward_as_tuple(rhs.ilabel, rhs.olabel);
+    if constexpr (internal::kPackedLabelCompare<Arc>) {
+      return internal::LabelPairSortKey(lhs.ilabel, lhs.olabel) <
+             internal::LabelPairSortKey(rhs.ilabel, rhs.olabel);
+    } else {
+      return std::forward_as_tuple(lhs.ilabel, lhs.olabel) <
+             std::forward_as_tuple(rhs.ilabel, rhs.olabel);
+    }
   }
 
   constexpr uint64_t Properties(uint64_t props) const {
@@ -211,8 +242,13 @@ class OLabelCompare {
   constexpr OLabelCompare() = default;
 
   constexpr bool operator()(const Arc &lhs, const Arc &rhs) const {
-    return std::forward_as_tuple(lhs.olabel, lhs.ilabel) <
-           std::forward_as_tuple(rhs.olabel, rhs.ilabel);
+    if constexpr (internal::kPackedLabelCompare<Arc>) {
+      return internal::LabelPairSortKey(lhs.olabel, lhs.ilabel) <
+             internal::LabelPairSortKey(rhs.olabel, rhs.ilabel);
+    } else {
+      return std::forward_as_tuple(lhs.olabel, lhs.ilabel) <
+             std::forward_as_tuple(rhs.olabel, rhs.ilabel);
+    }
   }
 
   constexpr uint64_t Properties(uint64_t props) const {
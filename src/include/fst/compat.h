@@ -44,6 +44,18 @@
 #define OPENFST_DEPRECATED(message)
 #endif
 
+// Marks a function whose result depends only on its arguments (including
+// memory reachable through reference or pointer arguments) and that has no
+// side effects, so repeated calls with the same arguments can be merged or
+// hoisted out of loops. Use this rather than [[gnu::const]] for functions
+// taking references: const additionally promises the function reads no
+// memory at all, which a reference parameter violates.
+#if defined(__GNUC__) || defined(__clang__)
+#define OPENFST_PURE [[gnu::pure]]
+#else
+#define OPENFST_PURE
+#endif
+
 namespace fst {
 
 // Downcasting.
@@ -21,7 +21,10 @@
 #define FST_EQUAL_H_
 
 #include <cstdint>
+#include <cstring>
+#include <optional>
 #include <string>
+#include <type_traits>
 
 #include <fst/log.h>
 #include <fst/fst.h>
@@ -72,6 +75,89 @@ struct SelectWeightApproxEqual {
   using WAE = WeightApproxEqual<float>;
 };
 
+namespace internal {
+
+// Compares state s of fst1 against state s of fst2: final weights, arcs in
+// order, and the arc-count sanity checks. Shared by both iteration
+// strategies in Equal below.
+template <class Arc, class WeightEqual>
+bool EqualState(const Fst<Arc> &fst1, const Fst<Arc> &fst2,
+                typename Arc::StateId s, WeightEqual &weight_equal) {
+  const auto &final1 = fst1.Final(s);
+  const auto &final2 = fst2.Final(s);
+  if (!weight_equal(final1, final2)) {
+    VLOG(1) << "Equal: Mismatched final weights at state " << s << " ("
+            << final1 << " != " << final2 << ")";
+    return false;
+  }
+  ArcIterator<Fst<Arc>> aiter1(fst1, s);
+  ArcIterator<Fst<Arc>> aiter2(fst2, s);
+  for (auto a = 0; !aiter1.Done() || !aiter2.Done(); ++a) {
+    if (aiter1.Done() || aiter2.Done()) {
+      VLOG(1) << "Equal: Mismatched number of arcs at state " << s;
+      return false;
+    }
+    const auto &arc1 = aiter1.Value();
+    const auto &arc2 = aiter2.Value();
+    // Matching arcs are the overwhelmingly common case, and for trivially
+    // copyable arc types (e.g. StdArc: four 4-byte fields) matching arcs
+    // are byte-identical, so one memcmp replaces four compare-and-branch
+    // tests. A mismatch falls through to the field comparisons below for
+    // reporting; approximately-equal weights still pass there. Note that
+    // byte-identical weights are accepted even when the weight comparison
+    // would reject them (e.g. two NoWeight() NaN representations).
+    if constexpr (std::is_trivially_copyable_v<Arc> && sizeof(Arc) <= 32) {
+      if (std::memcmp(&arc1, &arc2, sizeof(Arc)) == 0) {
+        aiter1.Next();
+        aiter2.Next();
+        continue;
+      }
+    }
+    if (arc1.ilabel != arc2.ilabel) {
+      VLOG(1) << "Equal: Mismatched arc input labels at state " << s
+              << ", arc " << a << " (" << arc1.ilabel << " != " << arc2.ilabel
+              << ")";
+      return false;
+    } else if (arc1.olabel != arc2.olabel) {
+      VLOG(1) << "Equal: Mismatched arc output labels at state " << s
+              << ", arc " << a << " (" << arc1.olabel << " != " << arc2.olabel
+              << ")";
+      return false;
+    } else if (!weight_equal(arc1.weight, arc2.weight)) {
+      VLOG(1) << "Equal: Mismatched arc weights at state " << s << ", arc "
+              << a << " (" << arc1.weight << " != " << arc2.weight << ")";
+      return false;
+    } else if (arc1.nextstate != arc2.nextstate) {
+      VLOG(1) << "Equal: Mismatched next state at state " << s << ", arc "
+              << a << " (" << arc1.nextstate << " != " << arc2.nextstate
+              << ")";
+      return false;
+    }
+    aiter1.Next();
+    aiter2.Next();
+  }
+  // Sanity checks: should never fail.
+  if (fst1.NumArcs(s) != fst2.NumArcs(s)) {
+    FSTERROR() << "Equal: Inconsistent arc counts at state " << s << " ("
+               << fst1.NumArcs(s) << " != " << fst2.NumArcs(s) << ")";
+    return false;
+  }
+  if (fst1.NumInputEpsilons(s) != fst2.NumInputEpsilons(s)) {
+    FSTERROR() << "Equal: Inconsistent input epsilon counts at state " << s
+               << " (" << fst1.NumInputEpsilons(s)
+               << " != " << fst2.NumInputEpsilons(s) << ")";
+    return false;
+  }
+  if (fst1.NumOutputEpsilons(s) != fst2.NumOutputEpsilons(s)) {
+    FSTERROR() << "Equal: Inconsistent output epsilon counts at state " << s
+               << " (" << fst1.NumOutputEpsilons(s)
+               << " != " << fst2.NumOutputEpsilons(s) << ")";
+  }
+  return true;
+}
+
+}  // namespace internal
+
 // Tests if two FSTs have the same states and arcs in the same order (when
 // etype & kEqualFst); optionally, also checks equality of FST types
 // (etype & kEqualFstTypes) and compatibility of stored properties
@@ -107,6 +193,25 @@ bool Equal(const Fst<Arc> &fst1, const Fst<Arc> &fst2, WeightEqual weight_equal,
             << " != " << fst2.Start() << ")";
     return false;
   }
+  // When both FSTs know their state counts up front (e.g. they are
+  // expanded), compare the counts once and iterate by state index. State
+  // IDs are dense in that case, so this visits the same states as the
+  // iterator loop below without paying two virtual Done() calls per state.
+  const std::optional<typename Arc::StateId> num_states1 =
+      fst1.NumStatesIfKnown();
+  const std::optional<typename Arc::StateId> num_states2 =
+      fst2.NumStatesIfKnown();
+  if (num_states1 && num_states2) {
+    if (*num_states1 != *num_states2) {
+      VLOG(1) << "Equal: Mismatched number of states (" << *num_states1
+              << " != " << *num_states2 << ")";
+      return false;
+    }
+    for (typename Arc::StateId s = 0; s < *num_states1; ++s) {
+      if (!internal::EqualState(fst1, fst2, s, weight_equal)) return false;
+    }
+    return true;
+  }
   StateIterator<Fst<Arc>> siter1(fst1);
   StateIterator<Fst<Arc>> siter2(fst2);
   while (!siter1.Done() || !siter2.Done()) {
@@ -120,62 +225,7 @@ bool Equal(const Fst<Arc> &fst1, const Fst<Arc> &fst2, WeightEqual weight_equal,
       VLOG(1) << "Equal: Mismatched states (" << s1 << "!= " << s2 << ")";
       return false;
     }
-    const auto &final1 = fst1.Final(s1);
-    const auto &final2 = fst2.Final(s2);
-    if (!weight_equal(final1, final2)) {
-      VLOG(1) << "Equal: Mismatched final weights at state " << s1 << " ("
-              << final1 << " != " << final2 << ")";
-      return false;
-    }
-    ArcIterator<Fst<Arc>> aiter1(fst1, s1);
-    ArcIterator<Fst<Arc>> aiter2(fst2, s2);
-    for (auto a = 0; !aiter1.Done() || !aiter2.Done(); ++a) {
-      if (aiter1.Done() || aiter2.Done()) {
-        VLOG(1) << "Equal: Mismatched number of arcs at state " << s1;
-        return false;
-      }
-      const auto &arc1 = aiter1.Value();
-      const auto &arc2 = aiter2.Value();
-      if (arc1.ilabel != arc2.ilabel) {
-        VLOG(1) << "Equal: Mismatched arc input labels at state " << s1
-                << ", arc " << a << " (" << arc1.ilabel << " != " << arc2.ilabel
-                << ")";
-        return false;
-      } else if (arc1.olabel != arc2.olabel) {
-        VLOG(1) << "Equal: Mismatched arc output labels at state " << s1
-                << ", arc " << a << " (" << arc1.olabel << " != " << arc2.olabel
-                << ")";
-        return false;
-      } else if (!weight_equal(arc1.weight, arc2.weight)) {
-        VLOG(1) << "Equal: Mismatched arc weights at state " << s1 << ", arc "
-                << a << " (" << arc1.weight << " != " << arc2.weight << ")";
-        return false;
-      } else if (arc1.nextstate != arc2.nextstate) {
-        VLOG(1) << "Equal: Mismatched next state at state " << s1 << ", arc "
-                << a << " (" << arc1.nextstate << " != " << arc2.nextstate
-                << ")";
-        return false;
-      }
-      aiter1.Next();
-      aiter2.Next();
-    }
-    // Sanity checks: should never fail.
-    if (fst1.NumArcs(s1) != fst2.NumArcs(s2)) {
-      FSTERROR() << "Equal: Inconsistent arc counts at state " << s1 << " ("
-                 << fst1.NumArcs(s1) << " != " << fst2.NumArcs(s2) << ")";
-      return false;
-    }
-    if (fst1.NumInputEpsilons(s1) != fst2.NumInputEpsilons(s2)) {
-      FSTERROR() << "Equal: Inconsistent input epsilon counts at state " << s1
-                 << " (" << fst1.NumInputEpsilons(s1)
-                 << " != " << fst2.NumInputEpsilons(s2) << ")";
-      return false;
-    }
-    if (fst1.NumOutputEpsilons(s1) != fst2.NumOutputEpsilons(s2)) {
-      FSTERROR() << "Equal: Inconsistent output epsilon counts at state " << s1
-                 << " (" << fst1.NumOutputEpsilons(s1)
-                 << " != " << fst2.NumOutputEpsilons(s2) << ")";
-    }
+    if (!internal::EqualState(fst1, fst2, s1, weight_equal)) return false;
     siter1.Next();
     siter2.Next();
   }
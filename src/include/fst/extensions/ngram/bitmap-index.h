@@ -20,9 +20,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <new>
 #include <utility>
 #include <vector>
 
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 #include <fst/compat.h>
 #include <fst/log.h>
 
@@ -88,6 +93,50 @@
 // The select indices have 6.25% overhead together.
 
 namespace fst {
+namespace internal {
+
+// Minimal allocator handing out Alignment-aligned storage. The index
+// vectors below use it with cache-line alignment so a group of 16
+// absolute-count search keys (or 4 blocks of zeros thresholds) never
+// straddles a line, and SIMD loads from the front of the arrays are
+// aligned.
+template <class T, std::size_t Alignment>
+struct AlignedAllocator {
+  static_assert(Alignment >= alignof(T));
+  using value_type = T;
+
+  // The non-type Alignment parameter defeats allocator_traits' default
+  // rebind; spell it out.
+  template <class U>
+  struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <class U>
+  constexpr AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T* p, std::size_t) noexcept {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+
+  template <class U>
+  friend constexpr bool operator==(const AlignedAllocator&,
+                                   const AlignedAllocator<U, Alignment>&) {
+    return true;
+  }
+  template <class U>
+  friend constexpr bool operator!=(const AlignedAllocator&,
+                                   const AlignedAllocator<U, Alignment>&) {
+    return false;
+  }
+};
+
+}  // namespace internal
 
 class BitmapIndex {
  public:
@@ -131,20 +180,85 @@ class BitmapIndex {
   // Number of bytes used to store the rank index.
   size_t IndexBytes() const {
     return (rank_index_.size() * sizeof(rank_index_[0]) +
+            absolute_ones_counts_.size() * sizeof(absolute_ones_counts_[0]) +
+            relative_zeros_counts_.size() * sizeof(relative_zeros_counts_[0]) +
             select_0_index_.size() * sizeof(select_0_index_[0]) +
             select_1_index_.size() * sizeof(select_1_index_[0]));
   }
 
   // Returns the number of one bits in the bitmap
-  size_t GetOnesCount() const {
-    // We keep an extra entry with the total count.
-    return rank_index_.back().absolute_ones_count();
-  }
+  size_t GetOnesCount() const { return total_ones_; }
 
   // Returns the number of one bits in positions 0 to limit - 1.
   // REQUIRES: limit <= Bits()
   size_t Rank1(size_t end) const;
 
+  // Answers n Rank1 queries at once: out[i] = Rank1(ends[i]). For random
+  // query streams each Rank1 is bound by the latency of two cache misses
+  // (index entry and payload word); the batched loop issues prefetches
+  // several queries ahead so those misses overlap across the stream.
+  // REQUIRES: ends[i] <= Bits() for all i.
+  void Rank1Batch(const size_t* ends, size_t n, size_t* out) const;
+
+  // Accelerates a monotonically increasing stream of Rank1 queries whose
+  // positions are not known in advance (so Rank1Batch does not apply, e.g.
+  // building a derived table while walking the bitmap front to back). Each
+  // query prefetches the index and payload lines a fixed distance ahead of
+  // the current position, hiding the miss latency the next queries would
+  // otherwise pay. Queries need not be strictly increasing; a scanner is
+  // cheap to construct and holds only a reference to the index.
+  class RankScanner {
+   public:
+    explicit RankScanner(const BitmapIndex* index) : index_(index) {}
+
+    // Same contract as BitmapIndex::Rank1.
+    size_t Rank1(size_t end) {
+      const size_t word_index = end >> kStorageLogBitSize;
+      if (word_index != last_word_index_) {
+        last_word_index_ = word_index;
+        // Prefetches never fault, so running past the end of the arrays
+        // near the end of the scan is harmless.
+        const size_t ahead_word =
+            word_index + kPrefetchDistance * kUnitsPerRankIndexEntry;
+        const size_t ahead_block =
+            word_index / kUnitsPerRankIndexEntry + kPrefetchDistance;
+        __builtin_prefetch(index_->bits_ + ahead_word, /*rw=*/0,
+                           /*locality=*/1);
+        __builtin_prefetch(index_->absolute_ones_counts_.data() + ahead_block,
+                           /*rw=*/0, /*locality=*/1);
+        __builtin_prefetch(index_->rank_index_.data() + ahead_block,
+                           /*rw=*/0, /*locality=*/1);
+      }
+      return index_->Rank1(end);
+    }
+
+   private:
+    // Rank-index blocks ahead of the current query to prefetch; at 512 bits
+    // ranked per block this covers DRAM latency for dense scans without
+    // evicting useful lines on sparse ones.
+    static constexpr size_t kPrefetchDistance = 8;
+
+    const BitmapIndex* index_;
+    size_t last_word_index_ = SIZE_MAX;
+  };
+
+  // Returns {Get(index), Rank1(index)} with a single fetch of the payload
+  // word, for the common caller pattern that tests a bit and then ranks
+  // it; two separate calls load the same word twice.
+  // REQUIRES: index < Bits()
+  std::pair<bool, size_t> GetAndRank1(size_t index) const {
+    const size_t word_index = index >> kStorageLogBitSize;
+    const uint64_t word = bits_[word_index];
+    const int bit_index = index & kStorageBlockMask;
+    const bool bit = (word >> bit_index) & 1;
+    const uint32_t sum = GetIndexOnesCount(word_index);
+#if defined(__BMI2__)
+    return {bit, sum + __builtin_popcountll(_bzhi_u64(word, bit_index))};
+#else
+    return {bit, sum + __builtin_popcountll(word & ((kOne << bit_index) - 1))};
+#endif
+  }
+
   // Returns the number of zero bits in positions 0 to limit - 1.
   // REQUIRES: limit <= Bits()
   size_t Rank0(size_t end) const { return end - Rank1(end); }
@@ -163,7 +277,9 @@ class BitmapIndex {
 
   // Rebuilds from index for the associated Bitmap, should be called
   // whenever changes have been made to the Bitmap or else behavior
-  // of the indexed bitmap methods will be undefined.
+  // of the indexed bitmap methods will be undefined. The bits pointer is
+  // caller-owned and may have any alignment; aligning it to a cache line
+  // keeps the SIMD loads in the index build from straddling lines.
   void BuildIndex(const uint64_t* bits, size_t num_bits,
                   bool enable_select_0_index = false,
                   bool enable_select_1_index = false);
@@ -192,145 +308,183 @@ class BitmapIndex {
   // raising it because there are very few times a higher value would
   // make a difference. Thus, whether a higher value helps or hurts is harder
   // to measure. TODO(jrosenstock): Try to measure with low bit density.
+  // With the AVX2 scan the linear search is branch-free within each group
+  // of 8 keys, so a larger threshold costs at most a few extra vector
+  // compares where the scalar version would pay a branch per key.
+#if defined(__AVX2__)
+  static constexpr uint32_t kMaxLinearSearchBlocks = 32;
+#else
   static constexpr uint32_t kMaxLinearSearchBlocks = 8;
+#endif  // __AVX2__
+
+  // Alignment of the index vectors: one cache line, which is also the
+  // span of a RankIndexEntry's block and enough for any SIMD load the
+  // searches perform.
+  static constexpr std::size_t kCacheLineBytes = 64;
+
+  // Number of UINT32_MAX sentinel entries appended to absolute_ones_counts_
+  // so the vectorized linear scan in FindRankIndexEntry can always load a
+  // full SIMD vector without running off the array.
+  static constexpr uint32_t kAbsoluteCountsPadding = 8;
 
   // A RankIndexEntry covers a block of 8 64-bit words (one cache line on
-  // x86_64 and ARM). It consists of an absolute count of all the 1s that
-  // appear before this block, and 7 relative counts for the 1s within
-  // the block. relative_ones_count_k = popcount(block[0:k]).
-  // The relative counts are stored in bitfields.
-  // A RankIndexEntry takes 12 bytes, for 12/64 = 18.75% overhead.
+  // x86_64 and ARM). It holds the 7 relative counts for the 1s within
+  // the block: relative_ones_count_k = popcount(block[0:k]).
+  // The absolute count of all the 1s that appear before the block is kept
+  // in the parallel array absolute_ones_counts_ so that the rank/select
+  // searches, which touch only the absolute counts, read a dense array of
+  // 16 keys per cache line instead of pulling in the relative counts.
+  // A RankIndexEntry takes 8 bytes; together with the 4-byte absolute
+  // count that is 12 bytes per block, for 12/64 = 18.75% overhead.
   // See also documentation at the top of the file.
   class RankIndexEntry {
    public:
     RankIndexEntry() = default;
 
-    uint32_t absolute_ones_count() const { return absolute_ones_count_; }
-
     // Returns the popcounts of words *before* word `k` in the block.
     uint32_t relative_ones_count(size_t k) const {
       assert(k < 8);
-      // TODO(jrosenstock): Try a multiply here instead.
-      const uint32_t c = k < 4 ? 0 : relative_ones_count_4_;
-      // Load starting one byte before the three relative counts we want.
-      // This load is unaligned for `k < 4` and aligned otherwise.  The
-      // address is always within `RankIndexEntry`.
-      uint32_t relative_ones_counts_8x4 =
-          UnalignedLoad<uint32_t>(&relative_ones_counts_[k >> 2][0] - 1);
-#if ((defined __ORDER_LITTLE_ENDIAN__) || (defined _WIN32))
-      // Clear out the garbage byte.
-      relative_ones_counts_8x4 &= ~0xFF;
-      return c + ((relative_ones_counts_8x4 >> (8 * (k & 3))) & 0xFF);
-#else
-#error "Big-endian currently unsupported."
-#endif
+      // Table-driven shift/mask extraction from the packed payload: no
+      // k < 4 select, and the 16-bit count for word 4 is folded in for
+      // the upper words by masking.
+      static constexpr uint8_t kShift[8] = {0, 16, 24, 32, 0, 40, 48, 56};
+      static constexpr uint32_t kByteMask[8] = {0,      0xFF, 0xFF, 0xFF,
+                                                0xFFFF, 0xFF, 0xFF, 0xFF};
+      static constexpr uint32_t kCount4Mask[8] = {
+          0, 0, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFF};
+      return ((relatives_packed_ >> kShift[k]) & kByteMask[k]) +
+             (relatives_packed_ & kCount4Mask[k]);
     }
 
     uint32_t relative_ones_count_1() const {
-      return relative_ones_counts_[0][0];
+      return (relatives_packed_ >> 16) & 0xFF;
     }
     uint32_t relative_ones_count_2() const {
-      return relative_ones_counts_[0][1];
+      return (relatives_packed_ >> 24) & 0xFF;
     }
     uint32_t relative_ones_count_3() const {
-      return relative_ones_counts_[0][2];
+      return (relatives_packed_ >> 32) & 0xFF;
     }
-    uint32_t relative_ones_count_4() const { return relative_ones_count_4_; }
+    uint32_t relative_ones_count_4() const { return relatives_packed_ & 0xFFFF; }
     uint32_t relative_ones_count_5() const {
-      return relative_ones_count_4() + relative_ones_counts_[1][0];
+      return relative_ones_count_4() + ((relatives_packed_ >> 40) & 0xFF);
     }
     uint32_t relative_ones_count_6() const {
-      return relative_ones_count_4() + relative_ones_counts_[1][1];
+      return relative_ones_count_4() + ((relatives_packed_ >> 48) & 0xFF);
     }
     uint32_t relative_ones_count_7() const {
-      return relative_ones_count_4() + relative_ones_counts_[1][2];
+      return relative_ones_count_4() + (relatives_packed_ >> 56);
     }
 
-    void set_absolute_ones_count(uint32_t v) { absolute_ones_count_ = v; }
     void set_relative_ones_count_1(uint32_t v) {
       DFST_CHECK_LE(v, kStorageBitSize);
-      relative_ones_counts_[0][0] = v;
+      SetByte(16, v);
     }
     void set_relative_ones_count_2(uint32_t v) {
       DFST_CHECK_LE(v, 2 * kStorageBitSize);
-      relative_ones_counts_[0][1] = v;
+      SetByte(24, v);
     }
     void set_relative_ones_count_3(uint32_t v) {
       DFST_CHECK_LE(v, 3 * kStorageBitSize);
-      relative_ones_counts_[0][2] = v;
+      SetByte(32, v);
     }
     void set_relative_ones_count_4(uint32_t v) {
       DFST_CHECK_LE(v, 4 * kStorageBitSize);
-      DFST_CHECK_EQ(relative_ones_counts_[1][0], 0);
-      DFST_CHECK_EQ(relative_ones_counts_[1][1], 0);
-      DFST_CHECK_EQ(relative_ones_counts_[1][2], 0);
-      relative_ones_count_4_ = v;
+      DFST_CHECK_EQ(relatives_packed_ >> 40, 0);
+      relatives_packed_ =
+          (relatives_packed_ & ~uint64_t{0xFFFF}) | uint64_t{v};
     }
     void set_relative_ones_count_5(uint32_t v) {
       DFST_CHECK_LE(v, 5 * kStorageBitSize);
-      relative_ones_counts_[1][0] = v - relative_ones_count_4();
+      SetByte(40, v - relative_ones_count_4());
     }
     void set_relative_ones_count_6(uint32_t v) {
       DFST_CHECK_LE(v, 6 * kStorageBitSize);
-      relative_ones_counts_[1][1] = v - relative_ones_count_4();
+      SetByte(48, v - relative_ones_count_4());
     }
     void set_relative_ones_count_7(uint32_t v) {
       DFST_CHECK_LE(v, 7 * kStorageBitSize);
-      relative_ones_counts_[1][2] = v - relative_ones_count_4();
+      SetByte(56, v - relative_ones_count_4());
     }
 
    private:
-    // Popcount of 1s before this block.
-    // rank_index_[i].absolute_ones_count() == Rank1(512 * i).
-    uint32_t absolute_ones_count_ = 0;
+    // Stores `value` in the byte starting at bit `shift`.
+    void SetByte(unsigned shift, uint32_t value) {
+      DFST_CHECK_LT(value, 256);
+      relatives_packed_ = (relatives_packed_ & ~(uint64_t{0xFF} << shift)) |
+                          (uint64_t{value} << shift);
+    }
 
     // Popcount of 1s since the beginning of the block.
     // rank_index_[i].relative_ones_count(k) ==
     // rank_index_[i].relative_ones_count_k() ==
     //     Rank1(512 * i + 64 * k) - Rank1(512 * i).
     //
-    // Three consecutive uint64s may have a total of at most 3 * 64 = 192 < 256
-    // ones set. Thus we store `relative_ones_count_1(), ...
-    // relative_ones_count_3()` directly in the one-byte integers
-    // `relative_ones_counts_[0][0], ..., relative_ones_counts_[0][2]`. We use
-    // 16 bits for relative_ones_count_4_. In `relative_ones_counts_[1][0], ...
-    // relative_ones_counts_[1][2]`, we store the difference between
-    // `relative_ones_counts_5(), ... `relative_ones_counts_7()` and
-    // `relative_ones_count_4_`.  We put `relative_ones_count_4_` in a 16-bit
-    // integer because it's often used as the first split point for binary
-    // search, so we save an addition there.
-    //
-    // More explicitly:
+    // All seven counts are packed into a single uint64_t, laid out (low bits
+    // first) as:
     // ```
-    // relative_ones_counts_[0][0] = relative_ones_count_1()
-    // relative_ones_counts_[0][1] = relative_ones_count_2()
-    // relative_ones_counts_[0][2] = relative_ones_count_3()
-    // relative_ones_counts_[1][0] =
-    //     relative_ones_count_5() - relative_ones_count_4()
-    // relative_ones_counts_[1][1] =
-    //     relative_ones_count_6() - relative_ones_count_4()
-    // relative_ones_counts_[1][2] =
-    //     relative_ones_count_7() - relative_ones_count_4()
+    // bits  0..15: relative_ones_count_4()
+    // bits 16..23: relative_ones_count_1()
+    // bits 24..31: relative_ones_count_2()
+    // bits 32..39: relative_ones_count_3()
+    // bits 40..47: relative_ones_count_5() - relative_ones_count_4()
+    // bits 48..55: relative_ones_count_6() - relative_ones_count_4()
+    // bits 56..63: relative_ones_count_7() - relative_ones_count_4()
     // ```
     //
-    // (As a consequence, it is an error to call set_relative_ones_count_4()
-    // after calling set_relative_ones_count_N() for N in {5, 6, 7}.)
-    uint16_t relative_ones_count_4_ = 0;
-    uint8_t relative_ones_counts_[2][3] = {{0, 0, 0}, {0, 0, 0}};
+    // Three consecutive uint64s may have a total of at most 3 * 64 = 192 < 256
+    // ones set, so counts 1-3 and the differences for counts 5-7 each fit in
+    // one byte. We give `relative_ones_count_4()` 16 bits at the bottom
+    // because it's often used as the first split point for binary search, so
+    // we save an addition (and a shift) there.
+    //
+    // Since the layout is expressed as shifts on an integer rather than as a
+    // byte array, it is independent of host endianness.
+    //
+    // (As a consequence of storing counts 5-7 relative to count 4, it is an
+    // error to call set_relative_ones_count_4() after calling
+    // set_relative_ones_count_N() for N in {5, 6, 7}.)
+    uint64_t relatives_packed_ = 0;
   };
-  static_assert(sizeof(RankIndexEntry) == 4 + 8,
-                "RankIndexEntry should be 12 bytes.");
+  static_assert(sizeof(RankIndexEntry) == 8,
+                "RankIndexEntry should be 8 bytes.");
 
   // Returns, from the index, the count of ones up to array_index.
-  uint32_t GetIndexOnesCount(size_t array_index) const;
-
-  // Finds the entry in the rank index for the block containing the
-  // bit_index-th 1 bit.
-  const RankIndexEntry& FindRankIndexEntry(size_t bit_index) const;
+  // Defined here so Rank1 and the batched queries inline it; it is a
+  // handful of instructions on the hot path of every rank query.
+  uint32_t GetIndexOnesCount(size_t array_index) const {
+    const size_t block = array_index / kUnitsPerRankIndexEntry;
+    const uint32_t ones_count = absolute_ones_counts_[block];
+    static_assert(kUnitsPerRankIndexEntry == 8);
+    return ones_count +
+           rank_index_[block].relative_ones_count(array_index %
+                                                  kUnitsPerRankIndexEntry);
+  }
 
-  // Finds the entry in the rank index for the block containing the
+  // Returns the word (0..7) within an 8-word block whose span contains the
+  // rembits-th one bit of the block, and decrements *rembits by the count
+  // of ones in the preceding words. The 3-level descent over the relative
+  // counts compiles to conditional moves, so uniformly-distributed select
+  // queries pay no branch mispredictions here.
+  static uint32_t SelectOnesWordInBlock(const RankIndexEntry& entry,
+                                        uint32_t* rembits);
+
+  // As above, but for the rembits-th zero bit of the block. The thresholds
+  // are the block's entry in relative_zeros_counts_, precomputed at
+  // BuildIndex time so the descent reads a flat array symmetric with the
+  // ones side instead of recomputing k * 64 - relative_ones_count(k) at
+  // every step.
+  static uint32_t SelectZerosWordInBlock(const uint16_t* zeros_counts,
+                                         uint32_t* rembits);
+
+  // Finds the block index in the rank index for the block containing the
+  // bit_index-th 1 bit. Marked hot so the optimizer keeps it (and its
+  // search loops) on favorably laid-out text alongside the select calls.
+  [[gnu::hot]] uint32_t FindRankIndexEntry(size_t bit_index) const;
+
+  // Finds the block index in the rank index for the block containing the
   // bit_index-th 0 bit.
-  const RankIndexEntry& FindInvertedRankIndexEntry(size_t bit_index) const;
+  [[gnu::hot]] uint32_t FindInvertedRankIndexEntry(size_t bit_index) const;
 
   // We create a combined primary and secondary index, with one extra entry
   // to hold the total number of bits.
@@ -343,7 +497,29 @@ class BitmapIndex {
   const uint64_t* bits_ = nullptr;
   size_t num_bits_ = 0;
 
-  std::vector<RankIndexEntry> rank_index_;
+  // Total number of ones, cached from the index so the range checks in
+  // Rank1/Select0/Select0s don't touch the last index cache line. The same
+  // value is also kept as the extra entry of absolute_ones_counts_.
+  uint32_t total_ones_ = 0;
+
+  // Relative within-block counts; parallel to absolute_ones_counts_.
+  std::vector<RankIndexEntry,
+              internal::AlignedAllocator<RankIndexEntry, kCacheLineBytes>>
+      rank_index_;
+
+  // absolute_ones_counts_[i] == Rank1(512 * i), with one extra entry
+  // holding the total number of ones. Stored separately from the relative
+  // counts so the select binary search touches only these 4-byte keys.
+  std::vector<uint32_t, internal::AlignedAllocator<uint32_t, kCacheLineBytes>>
+      absolute_ones_counts_;
+
+  // relative_zeros_counts_[8 * i + k] == k * 64 - relative_ones_count_k
+  // for block i: the count of zeros before word k within the block
+  // (entry 0 is always 0). Select0's within-block descent reads these
+  // directly rather than deriving them from the ones counts on every
+  // query. One cache line covers 4 blocks.
+  std::vector<uint16_t, internal::AlignedAllocator<uint16_t, kCacheLineBytes>>
+      relative_zeros_counts_;
 
   // Index of positions for Select0
   // select_0_index_[i] == Select0(kBitsPerSelect0Block * i).
@@ -155,8 +155,9 @@ class NGramFstImpl : public FstImpl<A> {
   StateId Start() const { return start_; }
 
   Weight Final(StateId state) const {
-    if (final_index_.Get(state)) {
-      return final_probs_[final_index_.Rank1(state)];
+    const std::pair<bool, size_t> bit_rank = final_index_.GetAndRank1(state);
+    if (bit_rank.first) {
+      return final_probs_[bit_rank.second];
     } else {
       return Weight::Zero();
     }
@@ -321,10 +322,13 @@ inline void NGramFstImpl<A>::GetStates(
       node_rank == 0 ? select_root_ : context_index_.Select0s(node_rank);
   size_t first_child = zeros.first + 1;
   ++cit;
-  if (context_index_.Get(first_child) != false) {
+  // The bit test and the rank of first_child share one bitmap fetch.
+  std::pair<bool, size_t> first_child_rank =
+      context_index_.GetAndRank1(first_child);
+  if (first_child_rank.first != false) {
     size_t last_child = zeros.second - 1;
     while (cit != context.rend()) {
-      children = context_words_ + context_index_.Rank1(first_child);
+      children = context_words_ + first_child_rank.second;
       loc = std::lower_bound(children, children + last_child - first_child + 1,
                              *cit);
       if (loc == children + last_child - first_child + 1 || *loc != *cit) {
@@ -337,7 +341,8 @@ inline void NGramFstImpl<A>::GetStates(
       zeros =
           node_rank == 0 ? select_root_ : context_index_.Select0s(node_rank);
       first_child = zeros.first + 1;
-      if (context_index_.Get(first_child) == false) break;
+      first_child_rank = context_index_.GetAndRank1(first_child);
+      if (first_child_rank.first == false) break;
       last_child = zeros.second - 1;
     }
   }
@@ -785,12 +790,15 @@ inline typename A::StateId NGramFstImpl<A>::Transition(
   std::pair<size_t, size_t> zeros =
       (node_rank == 0) ? select_root_ : context_index_.Select0s(node_rank);
   size_t first_child = zeros.first + 1;
-  if (context_index_.Get(first_child) == false) {
+  // The bit test and the rank of first_child share one bitmap fetch.
+  std::pair<bool, size_t> first_child_rank =
+      context_index_.GetAndRank1(first_child);
+  if (first_child_rank.first == false) {
     return node_rank;
   }
   size_t last_child = zeros.second - 1;
   for (int word = context.size() - 1; word >= 0; --word) {
-    children = context_words_ + context_index_.Rank1(first_child);
+    children = context_words_ + first_child_rank.second;
     loc = std::lower_bound(children, children + last_child - first_child + 1,
                            context[word]);
     if (loc == children + last_child - first_child + 1 ||
@@ -802,7 +810,8 @@ inline typename A::StateId NGramFstImpl<A>::Transition(
     zeros =
         (node_rank == 0) ? select_root_ : context_index_.Select0s(node_rank);
     first_child = zeros.first + 1;
-    if (context_index_.Get(first_child) == false) break;
+    first_child_rank = context_index_.GetAndRank1(first_child);
+    if (first_child_rank.first == false) break;
     last_child = zeros.second - 1;
   }
   return node_rank;
@@ -27,7 +27,40 @@
 
 #include <fst/log.h>
 
-#if defined(__BMI2__)  // Intel Bit Manipulation Instruction Set 2
+#if defined(__AVX512VBMI2__) && defined(FST_NTH_BIT_PREFER_COMPRESS)
+// Opt-in select-in-word via VPCOMPRESSB, for microarchitectures where PDEP
+// is microcoded and slow (notably AMD Zen 1/Zen 2). Compressing the byte
+// indices 0..63 by the word's bit mask leaves the positions of the set
+// bits, in order, in the low bytes of the result; the r-th such byte is
+// the answer. Define FST_NTH_BIT_PREFER_COMPRESS to select this over the
+// PDEP path.
+
+#include <immintrin.h>
+
+namespace fst {
+// Returns the position (0-63) of the r-th 1 bit in v.
+// 0 <= r < CountOnes(v) <= 64. Therefore, v must not be 0.
+inline int nth_bit(uint64_t v, uint32_t r) {
+  DFST_CHECK_NE(v, 0);
+  DFST_CHECK_LE(0, r);
+  DFST_CHECK_LT(r, __builtin_popcountll(v));
+
+  static constexpr uint8_t kIota[64] = {
+      0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+      16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+      32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+      48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63};
+  const __m512i iota =
+      _mm512_loadu_si512(reinterpret_cast<const __m512i*>(kIota));
+  alignas(64) uint8_t positions[64];
+  _mm512_storeu_si512(
+      reinterpret_cast<__m512i*>(positions),
+      _mm512_maskz_compress_epi8(static_cast<__mmask64>(v), iota));
+  return positions[r];
+}
+}  // namespace fst
+
+#elif defined(__BMI2__)  // Intel Bit Manipulation Instruction Set 2
 // PDEP requires BMI2; this is present starting with Haswell.
 
 #include <immintrin.h>
@@ -41,6 +74,9 @@ inline int nth_bit(uint64_t v, uint32_t r) {
   DFST_CHECK_LT(r, __builtin_popcountll(v));
 
   // PDEP example from https://stackoverflow.com/a/27453505
+  // This is the single-instruction-pair select-in-word idiom: PDEP deposits
+  // the r-th set bit of the mask into v's r-th one position, and the
+  // trailing-zero count (TZCNT on BMI targets) recovers its offset.
   // __builtin_ctzll is UB for 0, but the conditions above ensure that can't
   // happen.
   return __builtin_ctzll(_pdep_u64(uint64_t{1} << r, v));
@@ -21,6 +21,7 @@
 #define FST_FLOAT_WEIGHT_H_
 
 #include <algorithm>
+#include <charconv>
 #include <climits>
 #include <cmath>
 #include <cstddef>
@@ -42,6 +43,20 @@
 #include <fst/compat.h>
 #include <string_view>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Constexpr bit-casting for FloatWeightTpl::Hash; all supported compilers
+// provide the builtin, but degrade to the memcpy form if one does not.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_bit_cast)
+#define FST_FLOAT_WEIGHT_HAS_BIT_CAST 1
+#endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1927
+#define FST_FLOAT_WEIGHT_HAS_BIT_CAST 1
+#endif
+
 namespace fst {
 
 namespace internal {
@@ -51,6 +66,75 @@ template <class T>
 inline constexpr bool IsNan(T value) {
   return value != value;
 }
+
+// Scalar quantization step shared by the weight classes' Quantize methods:
+// floor(value / delta + 0.5) * delta. The default kDelta is a power of two,
+// so its reciprocal is exact and multiplying by it is bit-identical to the
+// division it replaces; that turns the common default-delta call into a
+// multiply instead of a ~14-cycle divide. Arbitrary deltas keep the true
+// division, since 1 / delta is generally not representable.
+template <class T>
+inline T QuantizeValue(T value, float delta) {
+  if (delta == kDelta) {
+    constexpr float kDeltaInv = 1.0F / kDelta;
+    return std::floor(value * kDeltaInv + 0.5F) * delta;
+  }
+  return std::floor(value / delta + 0.5F) * delta;
+}
+
+// Shared kernel for the per-semiring QuantizeRange overloads below:
+// out[i] = floor(in[i] / delta + 0.5) * delta for finite in[i], with
+// non-finite values passed through unchanged. Every Quantize in this
+// header skips exactly the non-finite values (NaN and both infinities),
+// so one kernel serves all four weight families. Under AVX2 the rounding
+// runs 8 (float) or 4 (double) lanes per step via ROUNDPS/PD in floor
+// mode, bit-identical to the scalar std::floor form; true division is
+// kept (QuantizeValue's reciprocal shortcut fires only when it is
+// bit-identical to dividing), so results match the scalar Quantize for
+// every delta.
+template <class T>
+inline void QuantizeValueRange(const T *in, size_t n, float delta, T *out) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<T, float>) {
+    const __m256 delta_v = _mm256_set1_ps(delta);
+    const __m256 half = _mm256_set1_ps(0.5F);
+    const __m256 abs_mask =
+        _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 pos_inf =
+        _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    for (; i + 8 <= n; i += 8) {
+      const __m256 x = _mm256_loadu_ps(in + i);
+      __m256 q = _mm256_add_ps(_mm256_div_ps(x, delta_v), half);
+      q = _mm256_round_ps(q, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+      q = _mm256_mul_ps(q, delta_v);
+      const __m256 finite =
+          _mm256_cmp_ps(_mm256_and_ps(x, abs_mask), pos_inf, _CMP_LT_OQ);
+      _mm256_storeu_ps(out + i, _mm256_blendv_ps(x, q, finite));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const __m256d delta_v = _mm256_set1_pd(delta);
+    const __m256d half = _mm256_set1_pd(0.5F);
+    const __m256d abs_mask =
+        _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+    const __m256d pos_inf =
+        _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    for (; i + 4 <= n; i += 4) {
+      const __m256d x = _mm256_loadu_pd(in + i);
+      __m256d q = _mm256_add_pd(_mm256_div_pd(x, delta_v), half);
+      q = _mm256_round_pd(q, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+      q = _mm256_mul_pd(q, delta_v);
+      const __m256d finite =
+          _mm256_cmp_pd(_mm256_and_pd(x, abs_mask), pos_inf, _CMP_LT_OQ);
+      _mm256_storeu_pd(out + i, _mm256_blendv_pd(x, q, finite));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) {
+    const T v = in[i];
+    out[i] = std::isfinite(v) ? QuantizeValue(v, delta) : v;
+  }
+}
 }  // namespace internal
 
 // Numeric limits class.
@@ -82,7 +166,17 @@ class FloatWeightTpl {
     return WriteType(strm, value_);
   }
 
-  size_t Hash() const {
+  constexpr size_t Hash() const {
+#if defined(FST_FLOAT_WEIGHT_HAS_BIT_CAST)
+    // Bit-cast the value's representation directly: constant-evaluable,
+    // no zero-initialized temporary, and the same hash values as the
+    // memcpy fallback below on little-endian hosts.
+    if constexpr (sizeof(T) == 4) {
+      return __builtin_bit_cast(uint32_t, value_);
+    } else if constexpr (sizeof(T) == 8) {
+      return __builtin_bit_cast(uint64_t, value_);
+    }
+#endif
     size_t hash = 0;
     // Avoid using union, which would be undefined behavior.
     // Use memcpy, similar to bit_cast, but sizes may be different.
@@ -112,6 +206,45 @@ class FloatWeightTpl {
 // Single-precision float weight.
 using FloatWeight = FloatWeightTpl<float>;
 
+// A FloatWeightTpl-derived weight is layout-compatible with its bare value
+// type: one T member, standard layout, no padding. These views let callers
+// keep per-element metadata in parallel arrays with weights packed in a
+// plain T[], or hand existing std::vector<Weight> storage to the batch
+// kernels in this header, without copying in either direction. The casts
+// are checked by the same static_asserts those kernels rely on; the viewed
+// array's length is the caller's to track.
+template <class W>
+inline const typename W::ValueType *WeightsAsValues(const W *weights) {
+  static_assert(sizeof(W) == sizeof(typename W::ValueType) &&
+                    std::is_standard_layout_v<W>,
+                "Weight must be layout-compatible with its value type.");
+  return reinterpret_cast<const typename W::ValueType *>(weights);
+}
+
+template <class W>
+inline typename W::ValueType *WeightsAsValues(W *weights) {
+  static_assert(sizeof(W) == sizeof(typename W::ValueType) &&
+                    std::is_standard_layout_v<W>,
+                "Weight must be layout-compatible with its value type.");
+  return reinterpret_cast<typename W::ValueType *>(weights);
+}
+
+template <class W>
+inline const W *ValuesAsWeights(const typename W::ValueType *values) {
+  static_assert(sizeof(W) == sizeof(typename W::ValueType) &&
+                    std::is_standard_layout_v<W>,
+                "Weight must be layout-compatible with its value type.");
+  return reinterpret_cast<const W *>(values);
+}
+
+template <class W>
+inline W *ValuesAsWeights(typename W::ValueType *values) {
+  static_assert(sizeof(W) == sizeof(typename W::ValueType) &&
+                    std::is_standard_layout_v<W>,
+                "Weight must be layout-compatible with its value type.");
+  return reinterpret_cast<W *>(values);
+}
+
 template <class T>
 constexpr bool operator==(const FloatWeightTpl<T> &w1,
                           const FloatWeightTpl<T> &w2) {
@@ -166,18 +299,67 @@ constexpr bool ApproxEqual(const FloatWeightTpl<T> &w1,
   return FloatApproxEqual(w1.Value(), w2.Value(), delta);
 }
 
+// True iff ApproxEqual(a[i], b[i], delta) for every i < n. Used for diffing
+// whole weight vectors, where a single mismatch should stop the scan: the
+// AVX2 path checks 8 float (4 double) pairs with two compares and one
+// movemask before touching the next group, and NaN lanes fail the ordered
+// compare just as they fail the scalar predicate.
+template <class T>
+inline bool ApproxEqualRange(const FloatWeightTpl<T> *a,
+                             const FloatWeightTpl<T> *b, size_t n,
+                             float delta = kDelta) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(FloatWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  if constexpr (std::is_same_v<T, float>) {
+    const float *va = reinterpret_cast<const float *>(a);
+    const float *vb = reinterpret_cast<const float *>(b);
+    const __m256 d = _mm256_set1_ps(delta);
+    for (; i + 8 <= n; i += 8) {
+      const __m256 x = _mm256_loadu_ps(va + i);
+      const __m256 y = _mm256_loadu_ps(vb + i);
+      const __m256 m = _mm256_and_ps(
+          _mm256_cmp_ps(x, _mm256_add_ps(y, d), _CMP_LE_OQ),
+          _mm256_cmp_ps(y, _mm256_add_ps(x, d), _CMP_LE_OQ));
+      if (_mm256_movemask_ps(m) != 0xFF) return false;
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *va = reinterpret_cast<const double *>(a);
+    const double *vb = reinterpret_cast<const double *>(b);
+    const __m256d d = _mm256_set1_pd(delta);
+    for (; i + 4 <= n; i += 4) {
+      const __m256d x = _mm256_loadu_pd(va + i);
+      const __m256d y = _mm256_loadu_pd(vb + i);
+      const __m256d m = _mm256_and_pd(
+          _mm256_cmp_pd(x, _mm256_add_pd(y, d), _CMP_LE_OQ),
+          _mm256_cmp_pd(y, _mm256_add_pd(x, d), _CMP_LE_OQ));
+      if (_mm256_movemask_pd(m) != 0xF) return false;
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) {
+    if (!FloatApproxEqual(a[i].Value(), b[i].Value(), delta)) return false;
+  }
+  return true;
+}
+
 template <class T>
 inline std::ostream &operator<<(std::ostream &strm,
                                 const FloatWeightTpl<T> &w) {
-  if (w.Value() == FloatLimits<T>::PosInfinity()) {
-    return strm << "Infinity";
-  } else if (w.Value() == FloatLimits<T>::NegInfinity()) {
-    return strm << "-Infinity";
-  } else if (internal::IsNan(w.Value())) {
-    return strm << "BadNumber";
-  } else {
-    return strm << w.Value();
-  }
+  // Text dumps are dominated by finite weights plus the ubiquitous +Inf
+  // (tropical and log Zero), so the three special values are classified in
+  // one pass and looked up in a table rather than compared and printed in
+  // three separate branches.
+  const T v = w.Value();
+  const int cls = v == FloatLimits<T>::PosInfinity()   ? 0
+                  : v == FloatLimits<T>::NegInfinity() ? 1
+                  : internal::IsNan(v)                 ? 2
+                                                       : 3;
+  if (cls == 3) return strm << v;
+  static constexpr std::string_view kNames[] = {"Infinity", "-Infinity",
+                                                "BadNumber"};
+  return strm << kNames[cls];
 }
 
 template <class T>
@@ -189,6 +371,22 @@ inline std::istream &operator>>(std::istream &strm, FloatWeightTpl<T> &w) {
   } else if (s == "-Infinity") {
     w = FloatWeightTpl<T>(FloatLimits<T>::NegInfinity());
   } else {
+#if defined(__cpp_lib_to_chars)
+    // from_chars parses straight into T: no locale lookup, and no
+    // double-to-float narrowing for single-precision weights. Unlike
+    // strtod it rejects a leading '+', which strtod-parsed inputs may
+    // carry, so skip one explicitly.
+    const char *first = s.c_str();
+    const char *last = first + s.size();
+    if (first != last && *first == '+') ++first;
+    T f;
+    const auto [ptr, ec] = std::from_chars(first, last, f);
+    if (ec != std::errc() || ptr != last) {
+      strm.clear(std::ios::badbit);
+    } else {
+      w = FloatWeightTpl<T>(f);
+    }
+#else
     char *p;
     T f = strtod(s.c_str(), &p);
     if (p < s.c_str() + s.size()) {
@@ -196,6 +394,7 @@ inline std::istream &operator>>(std::istream &strm, FloatWeightTpl<T> &w) {
     } else {
       w = FloatWeightTpl<T>(f);
     }
+#endif
   }
   return strm;
 }
@@ -222,9 +421,12 @@ class TropicalWeightTpl : public FloatWeightTpl<T> {
   }
 
   static const std::string &Type() {
-    static const std::string *const type = new std::string(
-        fst::StrCat("tropical", FloatWeightTpl<T>::GetPrecisionString()));
-    return *type;
+    // All type names fit in the small-string buffer, so the magic
+    // static holds its characters in static storage with no heap
+    // allocation and no pointer chase per call.
+    static const std::string type =
+        fst::StrCat("tropical", FloatWeightTpl<T>::GetPrecisionString());
+    return type;
   }
 
   constexpr bool Member() const {
@@ -249,10 +451,12 @@ class TropicalWeightTpl : public FloatWeightTpl<T> {
   }
 
   TropicalWeightTpl<T> Quantize(float delta = kDelta) const {
-    if (!Member() || Value() == Limits::PosInfinity()) {
+    // NaN and both infinities pass through; a single finiteness test covers
+    // all three (and the non-member cases) in one compare.
+    if (!std::isfinite(Value())) {
       return *this;
     } else {
-      return TropicalWeightTpl<T>(std::floor(Value() / delta + 0.5F) * delta);
+      return TropicalWeightTpl<T>(internal::QuantizeValue(Value(), delta));
     }
   }
 
@@ -269,9 +473,15 @@ using TropicalWeight = TropicalWeightTpl<float>;
 template <class T>
 constexpr TropicalWeightTpl<T> Plus(const TropicalWeightTpl<T> &w1,
                                     const TropicalWeightTpl<T> &w2) {
-  return (!w1.Member() || !w2.Member()) ? TropicalWeightTpl<T>::NoWeight()
-         : w1.Value() < w2.Value()      ? w1
-                                        : w2;
+  // The two membership tests are combined with & rather than the
+  // short-circuiting && so that they evaluate unconditionally; both
+  // selects then compile to conditional moves (MINSS plus a CMOV-style
+  // blend) instead of the chain of compare-and-branch pairs the
+  // short-circuit form produces, which mispredict heavily on mixed
+  // weight streams.
+  return (w1.Member() & w2.Member())
+             ? (w1.Value() < w2.Value() ? w1 : w2)
+             : TropicalWeightTpl<T>::NoWeight();
 }
 
 // See comment at operator==(FloatWeightTpl<float>, FloatWeightTpl<float>)
@@ -419,6 +629,366 @@ constexpr TropicalWeightTpl<double> Power<TropicalWeightTpl<double>>(
   return Power<double, size_t, true>(weight, n);
 }
 
+namespace internal {
+
+// Shared implementation for the tropical and log batch Power overloads
+// below: in both semirings Power scales the value by the exponent and
+// One() is 0, so the same vector kernel serves both. The NoWeight and
+// One() special cases from the scalar Power are folded in with lane
+// masks; the exponent-side conditions are uniform across the batch and
+// hoisted out of the loop.
+template <class Weight, class T, class V>
+inline void LinearPowerRange(const Weight *ws, size_t n_elem, V exponent,
+                             Weight *out) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(Weight) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  // When T is float but the exponent is double, the scalar Power
+  // multiplies in double precision; that case falls through to the
+  // scalar loop rather than change rounding.
+  if constexpr (std::is_same_v<T, float> && !std::is_same_v<V, double>) {
+    const float *a = reinterpret_cast<const float *>(ws);
+    float *o = reinterpret_cast<float *>(out);
+    const __m256 neg_inf = _mm256_set1_ps(FloatLimits<float>::NegInfinity());
+    const __m256 bad_value = _mm256_set1_ps(FloatLimits<float>::NumberBad());
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 nv = _mm256_set1_ps(static_cast<float>(exponent));
+    const __m256 n_bad = _mm256_castsi256_ps(
+        _mm256_set1_epi32(internal::IsNan(exponent) ? -1 : 0));
+    const __m256 n_zero =
+        _mm256_castsi256_ps(_mm256_set1_epi32(exponent == 0 ? -1 : 0));
+    for (; i + 8 <= n_elem; i += 8) {
+      const __m256 v = _mm256_loadu_ps(a + i);
+      const __m256 bad =
+          _mm256_or_ps(_mm256_cmp_ps(v, neg_inf, _CMP_NGT_UQ), n_bad);
+      const __m256 one =
+          _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_EQ_OQ), n_zero);
+      __m256 r = _mm256_mul_ps(v, nv);
+      r = _mm256_blendv_ps(r, zero, one);
+      r = _mm256_blendv_ps(r, bad_value, bad);
+      _mm256_storeu_ps(o + i, r);
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(ws);
+    double *o = reinterpret_cast<double *>(out);
+    const __m256d neg_inf = _mm256_set1_pd(FloatLimits<double>::NegInfinity());
+    const __m256d bad_value = _mm256_set1_pd(FloatLimits<double>::NumberBad());
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d nv = _mm256_set1_pd(static_cast<double>(exponent));
+    const __m256d n_bad = _mm256_castsi256_pd(
+        _mm256_set1_epi64x(internal::IsNan(exponent) ? -1 : 0));
+    const __m256d n_zero =
+        _mm256_castsi256_pd(_mm256_set1_epi64x(exponent == 0 ? -1 : 0));
+    for (; i + 4 <= n_elem; i += 4) {
+      const __m256d v = _mm256_loadu_pd(a + i);
+      const __m256d bad =
+          _mm256_or_pd(_mm256_cmp_pd(v, neg_inf, _CMP_NGT_UQ), n_bad);
+      const __m256d one =
+          _mm256_or_pd(_mm256_cmp_pd(v, zero, _CMP_EQ_OQ), n_zero);
+      __m256d r = _mm256_mul_pd(v, nv);
+      r = _mm256_blendv_pd(r, zero, one);
+      r = _mm256_blendv_pd(r, bad_value, bad);
+      _mm256_storeu_pd(o + i, r);
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n_elem; ++i) out[i] = Power(ws[i], exponent);
+}
+
+}  // namespace internal
+
+// Batch version of Power: out[i] = Power(ws[i], exponent) for i in
+// [0, n_elem). See the batch Plus/Times overloads below for the layout
+// requirements.
+template <class T, class V>
+inline void PowerRange(const TropicalWeightTpl<T> *ws, size_t n_elem,
+                       V exponent, TropicalWeightTpl<T> *out) {
+  internal::LinearPowerRange<TropicalWeightTpl<T>, T, V>(ws, n_elem, exponent,
+                                                         out);
+}
+
+// Batch versions of Plus and Times over contiguous weight arrays:
+// out[i] = Plus(w1[i], w2[i]) (resp. Times) for i in [0, n). Since
+// tropical Plus is an IEEE min and Times an IEEE add, element-wise
+// reductions over weight arrays are data-parallel; these overloads
+// process 8 (float) or 4 (double) weights per step when compiled with
+// AVX2 support and match the scalar operations bit for bit, including
+// NoWeight propagation. The arrays may not overlap except exactly
+// (out == w1 or out == w2 is fine).
+template <class T>
+inline void PlusBatch(const TropicalWeightTpl<T> *w1,
+                      const TropicalWeightTpl<T> *w2,
+                      TropicalWeightTpl<T> *out, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(TropicalWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  // !Member() is "not greater than -inf", which the NGT_UQ comparison
+  // computes directly, including the unordered (NaN) case; any such lane
+  // must produce NoWeight just as scalar Plus does.
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(w1);
+    const float *b = reinterpret_cast<const float *>(w2);
+    float *o = reinterpret_cast<float *>(out);
+    const __m256 neg_inf = _mm256_set1_ps(FloatLimits<float>::NegInfinity());
+    const __m256 bad_value = _mm256_set1_ps(FloatLimits<float>::NumberBad());
+    for (; i + 8 <= n; i += 8) {
+      const __m256 va = _mm256_loadu_ps(a + i);
+      const __m256 vb = _mm256_loadu_ps(b + i);
+      const __m256 bad =
+          _mm256_or_ps(_mm256_cmp_ps(va, neg_inf, _CMP_NGT_UQ),
+                       _mm256_cmp_ps(vb, neg_inf, _CMP_NGT_UQ));
+      _mm256_storeu_ps(
+          o + i, _mm256_blendv_ps(_mm256_min_ps(va, vb), bad_value, bad));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(w1);
+    const double *b = reinterpret_cast<const double *>(w2);
+    double *o = reinterpret_cast<double *>(out);
+    const __m256d neg_inf = _mm256_set1_pd(FloatLimits<double>::NegInfinity());
+    const __m256d bad_value = _mm256_set1_pd(FloatLimits<double>::NumberBad());
+    for (; i + 4 <= n; i += 4) {
+      const __m256d va = _mm256_loadu_pd(a + i);
+      const __m256d vb = _mm256_loadu_pd(b + i);
+      const __m256d bad =
+          _mm256_or_pd(_mm256_cmp_pd(va, neg_inf, _CMP_NGT_UQ),
+                       _mm256_cmp_pd(vb, neg_inf, _CMP_NGT_UQ));
+      _mm256_storeu_pd(
+          o + i, _mm256_blendv_pd(_mm256_min_pd(va, vb), bad_value, bad));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = Plus(w1[i], w2[i]);
+}
+
+template <class T>
+inline void TimesBatch(const TropicalWeightTpl<T> *w1,
+                       const TropicalWeightTpl<T> *w2,
+                       TropicalWeightTpl<T> *out, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(TropicalWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  // Scalar Times is a bare IEEE add (see the correctness argument there),
+  // so no NoWeight mask is needed: NaNs propagate through the addition.
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(w1);
+    const float *b = reinterpret_cast<const float *>(w2);
+    float *o = reinterpret_cast<float *>(out);
+    for (; i + 8 <= n; i += 8) {
+      _mm256_storeu_ps(
+          o + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(w1);
+    const double *b = reinterpret_cast<const double *>(w2);
+    double *o = reinterpret_cast<double *>(out);
+    for (; i + 4 <= n; i += 4) {
+      _mm256_storeu_pd(
+          o + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = Times(w1[i], w2[i]);
+}
+
+// Fused relax step: PlusTimes(a, b, c) == Plus(a, Times(b, c)), i.e.
+// min(a, b + c) with the usual NoWeight propagation. This is the inner
+// operation of shortest-distance and composition loops; expressing it as
+// one call avoids materializing the intermediate weight at -O0 and gives
+// the batch form below a single kernel to mirror.
+template <class T>
+constexpr TropicalWeightTpl<T> PlusTimes(const TropicalWeightTpl<T> &a,
+                                         const TropicalWeightTpl<T> &b,
+                                         const TropicalWeightTpl<T> &c) {
+  return Plus(a, Times(b, c));
+}
+
+// Batch fused relax: out[i] = Plus(acc[i], Times(w[i], x[i])). The AVX2
+// loop is one ADDPS + MINPS pair per 8 lanes plus the NoWeight blend,
+// matching the scalar composition bit for bit.
+template <class T>
+inline void PlusTimesRange(const TropicalWeightTpl<T> *acc,
+                           const TropicalWeightTpl<T> *w,
+                           const TropicalWeightTpl<T> *x, size_t n,
+                           TropicalWeightTpl<T> *out) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(TropicalWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(acc);
+    const float *b = reinterpret_cast<const float *>(w);
+    const float *c = reinterpret_cast<const float *>(x);
+    float *o = reinterpret_cast<float *>(out);
+    const __m256 neg_inf = _mm256_set1_ps(FloatLimits<float>::NegInfinity());
+    const __m256 bad_value = _mm256_set1_ps(FloatLimits<float>::NumberBad());
+    for (; i + 8 <= n; i += 8) {
+      const __m256 va = _mm256_loadu_ps(a + i);
+      const __m256 vt =
+          _mm256_add_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i));
+      const __m256 bad =
+          _mm256_or_ps(_mm256_cmp_ps(va, neg_inf, _CMP_NGT_UQ),
+                       _mm256_cmp_ps(vt, neg_inf, _CMP_NGT_UQ));
+      _mm256_storeu_ps(
+          o + i, _mm256_blendv_ps(_mm256_min_ps(va, vt), bad_value, bad));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(acc);
+    const double *b = reinterpret_cast<const double *>(w);
+    const double *c = reinterpret_cast<const double *>(x);
+    double *o = reinterpret_cast<double *>(out);
+    const __m256d neg_inf = _mm256_set1_pd(FloatLimits<double>::NegInfinity());
+    const __m256d bad_value = _mm256_set1_pd(FloatLimits<double>::NumberBad());
+    for (; i + 4 <= n; i += 4) {
+      const __m256d va = _mm256_loadu_pd(a + i);
+      const __m256d vt =
+          _mm256_add_pd(_mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i));
+      const __m256d bad =
+          _mm256_or_pd(_mm256_cmp_pd(va, neg_inf, _CMP_NGT_UQ),
+                       _mm256_cmp_pd(vt, neg_inf, _CMP_NGT_UQ));
+      _mm256_storeu_pd(
+          o + i, _mm256_blendv_pd(_mm256_min_pd(va, vt), bad_value, bad));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = PlusTimes(acc[i], w[i], x[i]);
+}
+
+// Batch version of Quantize: out[i] = w[i].Quantize(delta) for i in
+// [0, n); in-place operation (out == w) is fine.
+template <class T>
+inline void QuantizeRange(const TropicalWeightTpl<T> *w, size_t n,
+                          TropicalWeightTpl<T> *out, float delta = kDelta) {
+  static_assert(sizeof(TropicalWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  internal::QuantizeValueRange(reinterpret_cast<const T *>(w), n, delta,
+                               reinterpret_cast<T *>(out));
+}
+
+// Specialization with a bulk accumulator. Tropical Plus is an IEEE min,
+// so the generic per-element Adder is exact already; what it cannot do
+// is reduce a range faster than one dependent min per element, which
+// AddRange below does.
+template <class T>
+class Adder<TropicalWeightTpl<T>> {
+ public:
+  using Weight = TropicalWeightTpl<T>;
+  using Limits = FloatLimits<T>;
+
+  explicit Adder(Weight w = Weight::Zero()) : sum_(w.Value()) {}
+
+  Weight Add(const Weight &w) {
+    sum_ = Plus(Sum(), w).Value();
+    return Sum();
+  }
+
+  // Adds a contiguous range of weights: exactly equivalent to calling Add
+  // on each element in order (min is associative), but reduced through
+  // four independent vector accumulators of 8 float lanes each under
+  // AVX2, hiding the MINPS latency that a serial min chain exposes.
+  // Non-member elements (NaN or -inf) are recorded in a parallel lane
+  // mask and collapse the sum to NoWeight, as repeated Plus would.
+  Weight AddRange(const Weight *begin, const Weight *end) {
+    if (begin == end) return Sum();
+    const T *p = WeightsAsValues(begin);
+    const size_t n = static_cast<size_t>(end - begin);
+    size_t i = 0;
+    bool bad = !(Limits::NegInfinity() < sum_);
+    T m = bad ? Limits::PosInfinity() : sum_;
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, float>) {
+      const __m256 neg_inf = _mm256_set1_ps(Limits::NegInfinity());
+      __m256 acc0 = _mm256_set1_ps(Limits::PosInfinity());
+      __m256 acc1 = acc0;
+      __m256 acc2 = acc0;
+      __m256 acc3 = acc0;
+      __m256 bad_acc = _mm256_setzero_ps();
+      for (; i + 32 <= n; i += 32) {
+        const __m256 v0 = _mm256_loadu_ps(p + i);
+        const __m256 v1 = _mm256_loadu_ps(p + i + 8);
+        const __m256 v2 = _mm256_loadu_ps(p + i + 16);
+        const __m256 v3 = _mm256_loadu_ps(p + i + 24);
+        bad_acc = _mm256_or_ps(
+            bad_acc,
+            _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(v0, neg_inf, _CMP_NGT_UQ),
+                                      _mm256_cmp_ps(v1, neg_inf, _CMP_NGT_UQ)),
+                         _mm256_or_ps(_mm256_cmp_ps(v2, neg_inf, _CMP_NGT_UQ),
+                                      _mm256_cmp_ps(v3, neg_inf, _CMP_NGT_UQ))));
+        acc0 = _mm256_min_ps(acc0, v0);
+        acc1 = _mm256_min_ps(acc1, v1);
+        acc2 = _mm256_min_ps(acc2, v2);
+        acc3 = _mm256_min_ps(acc3, v3);
+      }
+      __m256 acc = _mm256_min_ps(_mm256_min_ps(acc0, acc1),
+                                 _mm256_min_ps(acc2, acc3));
+      for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_loadu_ps(p + i);
+        bad_acc = _mm256_or_ps(bad_acc, _mm256_cmp_ps(v, neg_inf, _CMP_NGT_UQ));
+        acc = _mm256_min_ps(acc, v);
+      }
+      bad = bad || _mm256_movemask_ps(bad_acc) != 0;
+      // Horizontal min of the surviving 8 lanes. NaNs may have leaked
+      // into the accumulator, but any NaN implies bad, which overrides
+      // the reduced value below.
+      __m128 lo = _mm_min_ps(_mm256_castps256_ps128(acc),
+                             _mm256_extractf128_ps(acc, 1));
+      lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+      lo = _mm_min_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+      const float h = _mm_cvtss_f32(lo);
+      if (h < m) m = h;
+    }
+#endif  // __AVX2__
+    for (; i < n; ++i) {
+      const T v = p[i];
+      bad = bad || !(Limits::NegInfinity() < v);
+      if (v < m) m = v;
+    }
+    sum_ = bad ? Limits::NumberBad() : m;
+    return Sum();
+  }
+
+  Weight Sum() const { return Weight(sum_); }
+
+  void Reset(Weight w = Weight::Zero()) { sum_ = w.Value(); }
+
+ private:
+  T sum_;
+};
+
+// Maps a tropical weight value to an unsigned integer key whose integer
+// order matches the float order (the standard IEEE sign-magnitude to
+// biased transform: flip all bits of negative values, flip only the sign
+// bit of non-negative ones). Comparison sorts over weights then compare
+// integers instead of floats, which avoids the unordered-compare branch,
+// and the keys can feed a radix sort directly. NoWeight (NaN) maps above
+// PosInfinity, so the induced order is total — unlike operator< on the
+// raw values, which makes NaN incomparable and is undefined behavior to
+// std::sort.
+inline uint32_t TropicalSortKey(float v) {
+  const uint32_t u = bit_cast<uint32_t>(v);
+  return u ^
+         (static_cast<uint32_t>(static_cast<int32_t>(u) >> 31) | 0x80000000u);
+}
+
+inline uint64_t TropicalSortKey(double v) {
+  const uint64_t u = bit_cast<uint64_t>(v);
+  return u ^ (static_cast<uint64_t>(static_cast<int64_t>(u) >> 63) |
+              0x8000000000000000u);
+}
+
+// Sorts a weight array into the semiring's natural order (ascending
+// cost, Zero() and then NoWeight last) by comparing sort keys.
+template <class T>
+inline void SortByWeight(TropicalWeightTpl<T> *begin,
+                         TropicalWeightTpl<T> *end) {
+  std::sort(begin, end,
+            [](const TropicalWeightTpl<T> &a, const TropicalWeightTpl<T> &b) {
+              return TropicalSortKey(a.Value()) < TropicalSortKey(b.Value());
+            });
+}
+
 // Log semiring: (log(e^-x + e^-y), +, inf, 0).
 template <class T>
 class LogWeightTpl : public FloatWeightTpl<T> {
@@ -439,9 +1009,12 @@ class LogWeightTpl : public FloatWeightTpl<T> {
   static constexpr LogWeightTpl NoWeight() { return Limits::NumberBad(); }
 
   static const std::string &Type() {
-    static const std::string *const type = new std::string(
-        fst::StrCat("log", FloatWeightTpl<T>::GetPrecisionString()));
-    return *type;
+    // All type names fit in the small-string buffer, so the magic
+    // static holds its characters in static storage with no heap
+    // allocation and no pointer chase per call.
+    static const std::string type =
+        fst::StrCat("log", FloatWeightTpl<T>::GetPrecisionString());
+    return type;
   }
 
   constexpr bool Member() const {
@@ -450,10 +1023,12 @@ class LogWeightTpl : public FloatWeightTpl<T> {
   }
 
   LogWeightTpl<T> Quantize(float delta = kDelta) const {
-    if (!Member() || Value() == Limits::PosInfinity()) {
+    // NaN and both infinities pass through; a single finiteness test covers
+    // all three (and the non-member cases) in one compare.
+    if (!std::isfinite(Value())) {
       return *this;
     } else {
-      return LogWeightTpl<T>(std::floor(Value() / delta + 0.5F) * delta);
+      return LogWeightTpl<T>(internal::QuantizeValue(Value(), delta));
     }
   }
 
@@ -472,15 +1047,25 @@ using Log64Weight = LogWeightTpl<double>;
 
 namespace internal {
 
+// Threshold above which log1p(±e^-x) rounds to ±e^-x in double
+// precision: e^-x <= 2^-53 makes the quadratic term of log1p smaller
+// than half an ulp of the linear one. Equals 53 * ln(2).
+inline constexpr double kLogExpNegligible = 36.7368005696771014;
+
 // -log(e^-x + e^-y) = x - LogPosExp(y - x), assuming y >= x.
-inline double LogPosExp(double x) {
+OPENFST_PURE inline double LogPosExp(double x) {
   DFST_CHECK(!(x < 0));  // NB: NaN values are allowed.
+  // Beyond the threshold the log1p call is pure overhead; weight
+  // differences that large are routine in pruned lattices (and this
+  // also covers x == +inf), so the early out is frequently taken.
+  if (x > kLogExpNegligible) return exp(-x);
   return log1p(exp(-x));
 }
 
 // -log(e^-x - e^-y) = x - LogNegExp(y - x), assuming y >= x.
-inline double LogNegExp(double x) {
+OPENFST_PURE inline double LogNegExp(double x) {
   DFST_CHECK(!(x < 0));  // NB: NaN values are allowed.
+  if (x > kLogExpNegligible) return -exp(-x);
   return log1p(-exp(-x));
 }
 
@@ -511,36 +1096,44 @@ inline double KahanLogDiff(double a, double b, double *c) {
 }  // namespace internal
 
 template <class T>
-inline LogWeightTpl<T> Plus(const LogWeightTpl<T> &w1,
-                            const LogWeightTpl<T> &w2) {
-  using Limits = FloatLimits<T>;
+OPENFST_PURE inline LogWeightTpl<T> Plus(const LogWeightTpl<T> &w1,
+                                         const LogWeightTpl<T> &w2) {
   const T f1 = w1.Value();
   const T f2 = w2.Value();
-  if (f1 == Limits::PosInfinity()) {
-    return w2;
-  } else if (f2 == Limits::PosInfinity()) {
-    return w1;
-  } else if (f1 > f2) {
-    return LogWeightTpl<T>(f2 - internal::LogPosExp(f1 - f2));
-  } else {
-    return LogWeightTpl<T>(f1 - internal::LogPosExp(f2 - f1));
+  // min/max compile to MINSS/MAXSS, so the only data-dependent branches left
+  // are the two guards below, and both are overwhelmingly not-taken on finite
+  // inputs. |f1 - f2| is NaN exactly when an operand is NaN or when both are
+  // the same infinity; of those only Zero + Zero has a member result (Zero
+  // itself), while a NaN operand and the non-member -inf + -inf both yield
+  // NoWeight. An infinite difference means one operand dominates completely,
+  // and the smaller value is the answer whether the other operand is Zero or
+  // the difference merely overflowed.
+  const T d = std::abs(f1 - f2);
+  const T lo = std::min(f1, f2);
+  if (internal::IsNan(d)) {
+    return (f1 == FloatLimits<T>::PosInfinity() &&
+            f2 == FloatLimits<T>::PosInfinity())
+               ? w1
+               : LogWeightTpl<T>::NoWeight();
   }
+  if (d == FloatLimits<T>::PosInfinity()) return LogWeightTpl<T>(lo);
+  return LogWeightTpl<T>(lo - internal::LogPosExp(d));
 }
 
-inline LogWeightTpl<float> Plus(const LogWeightTpl<float> &w1,
-                                const LogWeightTpl<float> &w2) {
+OPENFST_PURE inline LogWeightTpl<float> Plus(const LogWeightTpl<float> &w1,
+                                             const LogWeightTpl<float> &w2) {
   return Plus<float>(w1, w2);
 }
 
-inline LogWeightTpl<double> Plus(const LogWeightTpl<double> &w1,
-                                 const LogWeightTpl<double> &w2) {
+OPENFST_PURE inline LogWeightTpl<double> Plus(const LogWeightTpl<double> &w1,
+                                              const LogWeightTpl<double> &w2) {
   return Plus<double>(w1, w2);
 }
 
 // Returns NoWeight if w1 < w2 (w1.Value() > w2.Value()).
 template <class T>
-inline LogWeightTpl<T> Minus(const LogWeightTpl<T> &w1,
-                             const LogWeightTpl<T> &w2) {
+OPENFST_PURE inline LogWeightTpl<T> Minus(const LogWeightTpl<T> &w1,
+                                          const LogWeightTpl<T> &w2) {
   using Limits = FloatLimits<T>;
   const T f1 = w1.Value();
   const T f2 = w2.Value();
@@ -551,16 +1144,27 @@ inline LogWeightTpl<T> Minus(const LogWeightTpl<T> &w1,
   return f1 - internal::LogNegExp(d);
 }
 
-inline LogWeightTpl<float> Minus(const LogWeightTpl<float> &w1,
-                                 const LogWeightTpl<float> &w2) {
+OPENFST_PURE inline LogWeightTpl<float> Minus(const LogWeightTpl<float> &w1,
+                                              const LogWeightTpl<float> &w2) {
   return Minus<float>(w1, w2);
 }
 
-inline LogWeightTpl<double> Minus(const LogWeightTpl<double> &w1,
-                                  const LogWeightTpl<double> &w2) {
+OPENFST_PURE inline LogWeightTpl<double> Minus(const LogWeightTpl<double> &w1,
+                                               const LogWeightTpl<double> &w2) {
   return Minus<double>(w1, w2);
 }
 
+// Batch version of Minus: out[i] = Minus(w1[i], w2[i]), as used by backward
+// probability and normalization loops. Each element needs its own log1p, so
+// unlike the tropical kernels this is a plain loop over the scalar call; it
+// exists so callers can treat the weight families uniformly, and any future
+// vector LogNegExp only has to change this one spot.
+template <class T>
+inline void MinusRange(const LogWeightTpl<T> *w1, const LogWeightTpl<T> *w2,
+                       LogWeightTpl<T> *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) out[i] = Minus(w1[i], w2[i]);
+}
+
 template <class T>
 constexpr LogWeightTpl<T> Times(const LogWeightTpl<T> &w1,
                                 const LogWeightTpl<T> &w2) {
@@ -578,6 +1182,17 @@ constexpr LogWeightTpl<double> Times(const LogWeightTpl<double> &w1,
   return Times<double>(w1, w2);
 }
 
+// Fused relax step, mirroring PlusTimes(Tropical...) above. The log Plus is
+// dominated by the transcendental, so there is no vector batch form; the
+// fused spelling still saves the intermediate in unoptimized builds and keeps
+// call sites semiring-generic.
+template <class T>
+OPENFST_PURE inline LogWeightTpl<T> PlusTimes(const LogWeightTpl<T> &a,
+                                              const LogWeightTpl<T> &b,
+                                              const LogWeightTpl<T> &c) {
+  return Plus(a, Times(b, c));
+}
+
 template <class T>
 constexpr LogWeightTpl<T> Divide(const LogWeightTpl<T> &w1,
                                  const LogWeightTpl<T> &w2,
@@ -625,6 +1240,23 @@ constexpr LogWeightTpl<double> Power<LogWeightTpl<double>>(
   return Power<double, size_t, true>(weight, n);
 }
 
+// Batch version of Power; see the tropical PowerRange overload above.
+template <class T, class V>
+inline void PowerRange(const LogWeightTpl<T> *ws, size_t n_elem, V exponent,
+                       LogWeightTpl<T> *out) {
+  internal::LinearPowerRange<LogWeightTpl<T>, T, V>(ws, n_elem, exponent, out);
+}
+
+// Batch version of Quantize; see the tropical QuantizeRange overload above.
+template <class T>
+inline void QuantizeRange(const LogWeightTpl<T> *w, size_t n,
+                          LogWeightTpl<T> *out, float delta = kDelta) {
+  static_assert(sizeof(LogWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  internal::QuantizeValueRange(reinterpret_cast<const T *>(w), n, delta,
+                               reinterpret_cast<T *>(out));
+}
+
 // Specialization using the Kahan compensated summation.
 template <class T>
 class Adder<LogWeightTpl<T>> {
@@ -649,6 +1281,43 @@ class Adder<LogWeightTpl<T>> {
     return Sum();
   }
 
+  // Adds a contiguous range of weights: equivalent to calling Add on each
+  // element in order, up to rounding. Rather than paying one log1p and one
+  // exp per element as Add does, this shifts every term by the range
+  // minimum m and sums in the linear domain,
+  //
+  //   -log(e^-sum + sum_i e^-f_i) = m - log(e^(m-sum) + sum_i e^(m-f_i)),
+  //
+  // so the whole range costs one exp per element plus a single log, and
+  // the exps are independent rather than chained through log-domain
+  // updates. The linear sum is Kahan-compensated; every shifted term lies
+  // in (0, 1], so the error bound is again independent of the number of
+  // addends. Zero() terms vanish via e^-inf == 0 and NoWeight (NaN)
+  // poisons the sum, exactly as with repeated Add.
+  Weight AddRange(const Weight *begin, const Weight *end) {
+    using Limits = FloatLimits<T>;
+    if (begin == end) return Sum();
+    double m = sum_;
+    for (const Weight *w = begin; w != end; ++w) {
+      const T f = w->Value();
+      if (f < m) m = f;
+    }
+    // All terms (including the running sum) are Zero.
+    if (m == Limits::PosInfinity()) return Sum();
+    double total = exp(m - sum_);
+    double comp = 0.0;  // Compensation for the linear-domain sum.
+    for (const Weight *w = begin; w != end; ++w) {
+      const double y = exp(m - w->Value()) - comp;
+      const double t = total + y;
+      comp = (t - total) - y;
+      total = t;
+    }
+    // total >= 1 since the term attaining the minimum contributes e^0.
+    sum_ = m - log(total);
+    c_ = 0.0;
+    return Sum();
+  }
+
   Weight Sum() const { return Weight(sum_); }
 
   void Reset(Weight w = Weight::Zero()) {
@@ -681,9 +1350,12 @@ class RealWeightTpl : public FloatWeightTpl<T> {
   static constexpr RealWeightTpl NoWeight() { return Limits::NumberBad(); }
 
   static const std::string &Type() {
-    static const std::string *const type = new std::string(
-        fst::StrCat("real", FloatWeightTpl<T>::GetPrecisionString()));
-    return *type;
+    // All type names fit in the small-string buffer, so the magic
+    // static holds its characters in static storage with no heap
+    // allocation and no pointer chase per call.
+    static const std::string type =
+        fst::StrCat("real", FloatWeightTpl<T>::GetPrecisionString());
+    return type;
   }
 
   constexpr bool Member() const {
@@ -692,10 +1364,12 @@ class RealWeightTpl : public FloatWeightTpl<T> {
   }
 
   RealWeightTpl<T> Quantize(float delta = kDelta) const {
-    if (!Member() || Value() == Limits::PosInfinity()) {
+    // NaN and both infinities pass through; a single finiteness test covers
+    // all three (and the non-member cases) in one compare.
+    if (!std::isfinite(Value())) {
       return *this;
     } else {
-      return RealWeightTpl<T>(std::floor(Value() / delta + 0.5F) * delta);
+      return RealWeightTpl<T>(internal::QuantizeValue(Value(), delta));
     }
   }
 
@@ -764,6 +1438,38 @@ inline RealWeightTpl<double> Minus(const RealWeightTpl<double> &w1,
   return Minus<double>(w1, w2);
 }
 
+// Batch version of Minus: out[i] = Minus(w1[i], w2[i]). Real Minus is a bare
+// IEEE subtract, so the AVX2 loop is a single SUBPS per 8 float (4 double)
+// lanes; NaN operands flow through the subtract exactly as in the scalar
+// form.
+template <class T>
+inline void MinusRange(const RealWeightTpl<T> *w1, const RealWeightTpl<T> *w2,
+                       RealWeightTpl<T> *out, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(RealWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(w1);
+    const float *b = reinterpret_cast<const float *>(w2);
+    float *o = reinterpret_cast<float *>(out);
+    for (; i + 8 <= n; i += 8) {
+      _mm256_storeu_ps(
+          o + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(w1);
+    const double *b = reinterpret_cast<const double *>(w2);
+    double *o = reinterpret_cast<double *>(out);
+    for (; i + 4 <= n; i += 4) {
+      _mm256_storeu_pd(
+          o + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = Minus(w1[i], w2[i]);
+}
+
 // The comments for Times(Tropical...) above apply here similarly.
 template <class T>
 constexpr RealWeightTpl<T> Times(const RealWeightTpl<T> &w1,
@@ -803,6 +1509,25 @@ constexpr RealWeightTpl<double> Divide(const RealWeightTpl<double> &w1,
 
 // The comments for Power<>(Tropical...) above apply here unchanged.
 
+namespace internal {
+
+// Exponentiation by squaring for integral exponents. Beats the libm pow call
+// by a wide margin for the small exponents that occur in practice, keeps the
+// result an exact chain of multiplies (Power(w, 2) == Times(w, w) bit for
+// bit, which pow does not guarantee), and is usable in constant expressions.
+template <class T>
+constexpr T IntPower(T base, size_t n) {
+  T result = 1;
+  while (n != 0) {
+    if (n & 1) result *= base;
+    base *= base;
+    n >>= 1;
+  }
+  return result;
+}
+
+}  // namespace internal
+
 template <class T, class V, bool Enable = !std::is_same_v<V, size_t>,
           typename std::enable_if_t<Enable> * = nullptr>
 constexpr RealWeightTpl<T> Power(const RealWeightTpl<T> &w, V n) {
@@ -814,17 +1539,46 @@ constexpr RealWeightTpl<T> Power(const RealWeightTpl<T> &w, V n) {
 
 // Specializes the library-wide template to use the above implementation; rules
 // of function template instantiation require this be a full instantiation.
+// The integral-exponent specializations use repeated squaring instead of pow.
 
 template <>
 constexpr RealWeightTpl<float> Power<RealWeightTpl<float>>(
     const RealWeightTpl<float> &weight, size_t n) {
-  return Power<float, size_t, true>(weight, n);
+  using Weight = RealWeightTpl<float>;
+  return !weight.Member()                  ? Weight::NoWeight()
+         : (n == 0 || weight == Weight::One())
+             ? Weight::One()
+             : Weight(internal::IntPower(weight.Value(), n));
 }
 
 template <>
 constexpr RealWeightTpl<double> Power<RealWeightTpl<double>>(
     const RealWeightTpl<double> &weight, size_t n) {
-  return Power<double, size_t, true>(weight, n);
+  using Weight = RealWeightTpl<double>;
+  return !weight.Member()                  ? Weight::NoWeight()
+         : (n == 0 || weight == Weight::One())
+             ? Weight::One()
+             : Weight(internal::IntPower(weight.Value(), n));
+}
+
+// Batch version of Power. Real Power goes through pow (or repeated
+// squaring for integral exponents) rather than a single multiply, so
+// this is a plain loop over the scalar calls; it exists so callers can
+// treat the three weight families uniformly.
+template <class T, class V>
+inline void PowerRange(const RealWeightTpl<T> *ws, size_t n_elem, V exponent,
+                       RealWeightTpl<T> *out) {
+  for (size_t i = 0; i < n_elem; ++i) out[i] = Power(ws[i], exponent);
+}
+
+// Batch version of Quantize; see the tropical QuantizeRange overload above.
+template <class T>
+inline void QuantizeRange(const RealWeightTpl<T> *w, size_t n,
+                          RealWeightTpl<T> *out, float delta = kDelta) {
+  static_assert(sizeof(RealWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  internal::QuantizeValueRange(reinterpret_cast<const T *>(w), n, delta,
+                               reinterpret_cast<T *>(out));
 }
 
 // Specialization using the Kahan compensated summation.
@@ -880,21 +1634,23 @@ class MinMaxWeightTpl : public FloatWeightTpl<T> {
   static constexpr MinMaxWeightTpl NoWeight() { return Limits::NumberBad(); }
 
   static const std::string &Type() {
-    static const std::string *const type = new std::string(
-        fst::StrCat("minmax", FloatWeightTpl<T>::GetPrecisionString()));
-    return *type;
+    // All type names fit in the small-string buffer, so the magic
+    // static holds its characters in static storage with no heap
+    // allocation and no pointer chase per call.
+    static const std::string type =
+        fst::StrCat("minmax", FloatWeightTpl<T>::GetPrecisionString());
+    return type;
   }
 
   // Fails for IEEE NaN.
   constexpr bool Member() const { return !internal::IsNan(Value()); }
 
   MinMaxWeightTpl<T> Quantize(float delta = kDelta) const {
-    // If one of infinities, or a NaN.
-    if (!Member() || Value() == Limits::NegInfinity() ||
-        Value() == Limits::PosInfinity()) {
+    // If one of infinities, or a NaN: one finiteness test covers all three.
+    if (!std::isfinite(Value())) {
       return *this;
     } else {
-      return MinMaxWeightTpl<T>(std::floor(Value() / delta + 0.5F) * delta);
+      return MinMaxWeightTpl<T>(internal::QuantizeValue(Value(), delta));
     }
   }
 
@@ -966,6 +1722,95 @@ constexpr MinMaxWeightTpl<double> Divide(const MinMaxWeightTpl<double> &w1,
   return Divide<double>(w1, w2, typ);
 }
 
+// Batch versions of Plus (min) and Times (max); see the tropical PlusBatch
+// overload above for the overall pattern. Both infinities are members here,
+// so a lane is NoWeight only when an operand is NaN, which the unordered
+// compare detects directly; MINPS/MAXPS return the second operand on ties,
+// matching the scalar ternaries in value.
+template <class T>
+inline void PlusBatch(const MinMaxWeightTpl<T> *w1,
+                      const MinMaxWeightTpl<T> *w2, MinMaxWeightTpl<T> *out,
+                      size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(MinMaxWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(w1);
+    const float *b = reinterpret_cast<const float *>(w2);
+    float *o = reinterpret_cast<float *>(out);
+    const __m256 bad_value = _mm256_set1_ps(FloatLimits<float>::NumberBad());
+    for (; i + 8 <= n; i += 8) {
+      const __m256 x = _mm256_loadu_ps(a + i);
+      const __m256 y = _mm256_loadu_ps(b + i);
+      const __m256 bad = _mm256_cmp_ps(x, y, _CMP_UNORD_Q);
+      _mm256_storeu_ps(o + i,
+                       _mm256_blendv_ps(_mm256_min_ps(x, y), bad_value, bad));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(w1);
+    const double *b = reinterpret_cast<const double *>(w2);
+    double *o = reinterpret_cast<double *>(out);
+    const __m256d bad_value = _mm256_set1_pd(FloatLimits<double>::NumberBad());
+    for (; i + 4 <= n; i += 4) {
+      const __m256d x = _mm256_loadu_pd(a + i);
+      const __m256d y = _mm256_loadu_pd(b + i);
+      const __m256d bad = _mm256_cmp_pd(x, y, _CMP_UNORD_Q);
+      _mm256_storeu_pd(o + i,
+                       _mm256_blendv_pd(_mm256_min_pd(x, y), bad_value, bad));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = Plus(w1[i], w2[i]);
+}
+
+template <class T>
+inline void TimesBatch(const MinMaxWeightTpl<T> *w1,
+                       const MinMaxWeightTpl<T> *w2, MinMaxWeightTpl<T> *out,
+                       size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  static_assert(sizeof(MinMaxWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  if constexpr (std::is_same_v<T, float>) {
+    const float *a = reinterpret_cast<const float *>(w1);
+    const float *b = reinterpret_cast<const float *>(w2);
+    float *o = reinterpret_cast<float *>(out);
+    const __m256 bad_value = _mm256_set1_ps(FloatLimits<float>::NumberBad());
+    for (; i + 8 <= n; i += 8) {
+      const __m256 x = _mm256_loadu_ps(a + i);
+      const __m256 y = _mm256_loadu_ps(b + i);
+      const __m256 bad = _mm256_cmp_ps(x, y, _CMP_UNORD_Q);
+      _mm256_storeu_ps(o + i,
+                       _mm256_blendv_ps(_mm256_max_ps(x, y), bad_value, bad));
+    }
+  } else if constexpr (std::is_same_v<T, double>) {
+    const double *a = reinterpret_cast<const double *>(w1);
+    const double *b = reinterpret_cast<const double *>(w2);
+    double *o = reinterpret_cast<double *>(out);
+    const __m256d bad_value = _mm256_set1_pd(FloatLimits<double>::NumberBad());
+    for (; i + 4 <= n; i += 4) {
+      const __m256d x = _mm256_loadu_pd(a + i);
+      const __m256d y = _mm256_loadu_pd(b + i);
+      const __m256d bad = _mm256_cmp_pd(x, y, _CMP_UNORD_Q);
+      _mm256_storeu_pd(o + i,
+                       _mm256_blendv_pd(_mm256_max_pd(x, y), bad_value, bad));
+    }
+  }
+#endif  // __AVX2__
+  for (; i < n; ++i) out[i] = Times(w1[i], w2[i]);
+}
+
+// Batch version of Quantize; see the tropical QuantizeRange overload above.
+template <class T>
+inline void QuantizeRange(const MinMaxWeightTpl<T> *w, size_t n,
+                          MinMaxWeightTpl<T> *out, float delta = kDelta) {
+  static_assert(sizeof(MinMaxWeightTpl<T>) == sizeof(T),
+                "Batch operations rely on weights being bare values.");
+  internal::QuantizeValueRange(reinterpret_cast<const T *>(w), n, delta,
+                               reinterpret_cast<T *>(out));
+}
+
 // Converts to tropical.
 template <>
 struct WeightConvert<LogWeight, TropicalWeight> {
@@ -1071,6 +1916,54 @@ struct WeightConvert<RealWeight, Real64Weight> {
   }
 };
 
+// Batch weight conversion: out[i] = WeightConvert<From, To>()(in[i]).
+// The real-to-log and log-to-real conversions above spend their time in a
+// libm log or exp per element; funneling whole vectors through this loop
+// lets toolchains with vector math (e.g. glibc's libmvec under -ffast-math
+// or -fopenmp-simd) batch those calls 4 or 8 lanes at a time, which a
+// convert-per-weight loop at the call site defeats. The purely
+// representational conversions compile to a plain copy loop.
+template <class From, class To>
+inline void WeightConvertRange(const From *in, size_t n, To *out) {
+  const WeightConvert<From, To> converter;
+  for (size_t i = 0; i < n; ++i) out[i] = converter(in[i]);
+}
+
+namespace internal {
+
+// Tiny counter-based random number generator (SplitMix64). The whole state is
+// one 64-bit counter, so a generator is 8 bytes instead of the 2.5 KB of an
+// mt19937_64, is trivially cheap to copy into worker threads, and seeds
+// spaced apart yield independent streams without leapfrogging. Statistical
+// quality is ample for random test weights; do not use it where mt19937_64
+// is relied on for reproducible sequences.
+class SplitMix64 {
+ public:
+  explicit SplitMix64(uint64_t seed) : state_(seed) {}
+
+  uint64_t operator()() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15u);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+  }
+
+  // Returns an integer uniformly distributed in [0, range) for range < 2^32,
+  // using the multiply-shift reduction instead of the rejection loop inside
+  // std::uniform_int_distribution; the resulting bias (under 2^-32) is
+  // irrelevant for test data.
+  uint64_t Uniform(uint64_t range) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(operator()())) *
+            range) >>
+           32;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+}  // namespace internal
+
 // This function object returns random integers chosen from [0,
 // num_random_weights). The allow_zero argument determines whether Zero() and
 // zero divisors should be returned in the random weight generation. This is
@@ -1083,19 +1976,20 @@ class FloatWeightGenerate {
       const size_t num_random_weights = kNumRandomWeights)
       : rand_(seed),
         allow_zero_(allow_zero),
-        num_random_weights_(num_random_weights) {}
+        num_random_weights_(num_random_weights),
+        sample_range_(num_random_weights + allow_zero) {}
 
   Weight operator()() const {
-    const int sample = std::uniform_int_distribution<>(
-        0, num_random_weights_ + allow_zero_ - 1)(rand_);
+    const int sample = rand_.Uniform(sample_range_);
     if (allow_zero_ && sample == num_random_weights_) return Weight::Zero();
     return Weight(sample);
   }
 
  private:
-  mutable std::mt19937_64 rand_;
+  mutable internal::SplitMix64 rand_;
   const bool allow_zero_;
   const size_t num_random_weights_;
+  const uint64_t sample_range_;
 };
 
 template <class T>
@@ -1157,14 +2051,16 @@ class WeightGenerate<MinMaxWeightTpl<T>> {
                           size_t num_random_weights = kNumRandomWeights)
       : rand_(seed),
         allow_zero_(allow_zero),
-        num_random_weights_(num_random_weights) {}
+        num_random_weights_(num_random_weights),
+        sample_range_(2 * num_random_weights + allow_zero + 1) {}
 
   Weight operator()() const {
-    const int sample = std::uniform_int_distribution<>(
-        -num_random_weights_, num_random_weights_ + allow_zero_)(rand_);
+    const int num = num_random_weights_;
+    // Uniform over [-num, num + allow_zero].
+    const int sample = static_cast<int>(rand_.Uniform(sample_range_)) - num;
     if (allow_zero_ && sample == 0) {
       return Weight::Zero();
-    } else if (sample == -num_random_weights_) {
+    } else if (sample == -num) {
       return Weight::One();
     } else {
       return Weight(sample);
@@ -1172,9 +2068,10 @@ class WeightGenerate<MinMaxWeightTpl<T>> {
   }
 
  private:
-  mutable std::mt19937_64 rand_;
+  mutable internal::SplitMix64 rand_;
   const bool allow_zero_;
   const size_t num_random_weights_;
+  const uint64_t sample_range_;
 };
 
 }  // namespace fst
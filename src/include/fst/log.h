@@ -24,6 +24,8 @@
 #include <cstdlib>
 #include <iostream>
 #include <ostream>
+#include <sstream>
+#include <string>
 #include <string_view>
 
 #include <fst/flags.h>
@@ -36,30 +38,50 @@ DECLARE_int32(v);
 class LogMessage {
  public:
   explicit LogMessage(std::string_view type) : fatal_(type == "FATAL") {
-    std::cerr << type << ": ";
+    buffer_ << type << ": ";
   }
 
   ~LogMessage() {
-    std::cerr << std::endl;
-    if (fatal_) exit(1);
+    buffer_ << '\n';
+    // Emits the whole line with a single call on the shared stream, rather
+    // than one locked insertion per operand, so concurrent writers cannot
+    // interleave within a message.
+    const std::string message = buffer_.str();
+    std::cerr.write(message.data(), message.size());
+    // No explicit flush for ordinary messages: cerr is unit-buffered, so the
+    // line above already reaches the descriptor, and an extra flush per log
+    // line only adds a second buffer drain. A fatal message is flushed
+    // explicitly in case the caller has cleared unitbuf on cerr.
+    if (fatal_) {
+      std::cerr.flush();
+      exit(1);
+    }
   }
 
-  std::ostream &stream() { return std::cerr; }
+  std::ostream &stream() { return buffer_; }
 
  private:
   bool fatal_;
+  std::ostringstream buffer_;
 };
 
 #define LOG(type) LogMessage(#type).stream()
 #define VLOG(level) if ((level) <= FST_FLAGS_v) LOG(INFO)
 
-// Checks.
+// Checks. The failure path is kept out of line and marked cold so that a
+// passing FST_CHECK costs one predicted-not-taken branch at the call site.
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((cold, noinline))
+#endif
+inline void
+FstCheckFail(std::string_view expr, std::string_view file, int line) {
+  LOG(FATAL) << "Check failed: \"" << expr << "\" file: " << file
+             << " line: " << line;
+}
+
 inline void FstCheck(bool x, std::string_view expr, std::string_view file,
                      int line) {
-  if (!x) {
-    LOG(FATAL) << "Check failed: \"" << expr << "\" file: " << file
-               << " line: " << line;
-  }
+  if (!x) FstCheckFail(expr, file, line);
 }
 
 #define FST_CHECK(x) FstCheck(static_cast<bool>(x), #x, __FILE__, __LINE__)
@@ -369,7 +369,17 @@ uint64_t ProjectProperties(uint64_t inprops, bool project_input);
 
 uint64_t RandGenProperties(uint64_t inprops, bool weighted);
 
-uint64_t RelabelProperties(uint64_t inprops);
+// Properties for a relabeled FST. Constexpr (unlike its neighbors) so that
+// masks built from compile-time property sets fold to constants.
+constexpr uint64_t RelabelProperties(uint64_t inprops) {
+  constexpr auto outprops =
+      kExpanded | kMutable | kError | kWeighted | kUnweighted |
+      kWeightedCycles | kUnweightedCycles | kCyclic | kAcyclic |
+      kInitialCyclic | kInitialAcyclic | kTopSorted | kNotTopSorted |
+      kAccessible | kNotAccessible | kCoAccessible | kNotCoAccessible |
+      kString | kNotString;
+  return outprops & inprops;
+}
 
 uint64_t ReplaceProperties(const std::vector<uint64_t> &inprops, size_t root,
                            bool epsilon_on_call, bool epsilon_on_return,
@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -37,61 +38,153 @@
 #include <fst/properties.h>
 #include <fst/symbol-table.h>
 #include <fst/util.h>
+#include <fst/vector-fst.h>
 #include <unordered_map>
 
 namespace fst {
+namespace internal {
 
-// Relabels either the input labels or output labels. The old to
-// new labels are specified using a vector of std::pair<Label, Label>.
-// Any label associations not specified are assumed to be identity
-// mapping. The destination labels must be valid labels (e.g., not kNoLabel).
-template <class Arc>
-void Relabel(
-    MutableFst<Arc> *fst,
-    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>> &        ipairs,
-    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>> &        opairs) {
-  using Label = typename Arc::Label;
+// Maps old labels to new labels for the relabel operations, which look a
+// label up once or twice per arc over potentially millions of arcs. When the
+// old labels are dense small integers — the common case, since they are
+// usually symbol-table indices — lookups go through a direct-indexed table,
+// so each arc pays one L1-resident array load instead of a hash probe that
+// typically misses cache. Sparse or huge label sets keep the hash map.
+template <class Label>
+class RelabelMap {
+ public:
+  RelabelMap() : dense_(false) {}
+
+  explicit RelabelMap(const std::vector<std::pair<Label, Label>> &pairs) {
+    Label max_label = -1;
+    bool has_negative = false;
+    for (const auto &[old_label, new_label] : pairs) {
+      if (old_label < 0) has_negative = true;
+      if (old_label > max_label) max_label = old_label;
+    }
+    const size_t table_size = static_cast<size_t>(max_label) + 1;
+    // The table is worth its memory when the label range is small outright,
+    // or bounded both absolutely and relative to the number of mappings.
+    dense_ = !pairs.empty() && !has_negative &&
+             (table_size <= kAlwaysDenseSize ||
+              (table_size <= kMaxTableSize && table_size / 16 <= pairs.size()));
+    if (dense_) {
+      table_.resize(table_size);
+      std::iota(table_.begin(), table_.end(), Label(0));
+      // Range construction of unordered_map keeps the first of any duplicate
+      // keys, so later pairs must not overwrite earlier ones here either.
+      for (auto it = pairs.rbegin(); it != pairs.rend(); ++it) {
+        table_[it->first] = it->second;
+      }
+    } else {
+      map_.reserve(pairs.size());
+      map_.insert(pairs.begin(), pairs.end());
+    }
+  }
+
+  // Returns the image of l, which is l itself for unmapped labels. A result
+  // of kNoLabel means l was explicitly mapped to no label.
+  Label Find(Label l) const {
+    if (dense_) {
+      return static_cast<size_t>(l) < table_.size() ? table_[l] : l;
+    }
+    if (auto it = map_.find(l); it != map_.end()) return it->second;
+    return l;
+  }
+
+ private:
+  // A table this small is cheaper than any hash map regardless of how few
+  // mappings it holds.
+  static constexpr size_t kAlwaysDenseSize = 1024;
+  // Caps the direct-indexed table at 64 MB of int32 labels.
+  static constexpr size_t kMaxTableSize = size_t{1} << 24;
+
+  std::vector<Label> table_;
+  std::unordered_map<Label, Label> map_;
+  bool dense_;
+};
+
+// Shared body of the Relabel overloads below, templated on the concrete FST
+// type so that iteration through a known backend (e.g. VectorFst) uses that
+// backend's own iterator specializations rather than a virtual call per arc.
+template <class FST>
+void RelabelImpl(
+    FST *fst,
+    const std::vector<std::pair<typename FST::Arc::Label,
+                                typename FST::Arc::Label>> &ipairs,
+    const std::vector<std::pair<typename FST::Arc::Label,
+                                typename FST::Arc::Label>> &opairs) {
+  using Label = typename FST::Arc::Label;
   const auto props = fst->Properties(kFstProperties, false);
+  // With no mappings at all every arc keeps its labels, so skip the arc
+  // sweep entirely.
+  if (ipairs.empty() && opairs.empty()) {
+    fst->SetProperties(RelabelProperties(props), kFstProperties);
+    return;
+  }
   // Constructs label-to-label maps.
-  const std::unordered_map<Label, Label> input_map(
-      ipairs.begin(), ipairs.end());
-  const std::unordered_map<Label, Label> output_map(
-      opairs.begin(), opairs.end());
-  for (StateIterator<MutableFst<Arc>> siter(*fst); !siter.Done();
-       siter.Next()) {
-    for (MutableArcIterator<MutableFst<Arc>> aiter(fst, siter.Value());
-         !aiter.Done(); aiter.Next()) {
+  const RelabelMap<Label> input_map(ipairs);
+  const RelabelMap<Label> output_map(opairs);
+  for (StateIterator<FST> siter(*fst); !siter.Done(); siter.Next()) {
+    for (MutableArcIterator<FST> aiter(fst, siter.Value()); !aiter.Done();
+         aiter.Next()) {
       auto arc = aiter.Value();
-      // dense_hash_map does not support find on the empty_key_val.
       // These labels should never be in an FST anyway.
       DFST_CHECK_NE(arc.ilabel, kNoLabel);
       DFST_CHECK_NE(arc.olabel, kNoLabel);
       // Relabels input.
-      if (auto it = input_map.find(arc.ilabel); it != input_map.end()) {
-        if (it->second == kNoLabel) {
-          FSTERROR() << "Input symbol ID " << arc.ilabel
-                     << " missing from target vocabulary";
-          fst->SetProperties(kError, kError);
-          return;
-        }
-        arc.ilabel = it->second;
+      const Label ilabel = input_map.Find(arc.ilabel);
+      if (ilabel == kNoLabel) {
+        FSTERROR() << "Input symbol ID " << arc.ilabel
+                   << " missing from target vocabulary";
+        fst->SetProperties(kError, kError);
+        return;
       }
+      arc.ilabel = ilabel;
       // Relabels output.
-      if (auto it = output_map.find(arc.olabel); it != output_map.end()) {
-        if (it->second == kNoLabel) {
-          FSTERROR() << "Output symbol id " << arc.olabel
-                     << " missing from target vocabulary";
-          fst->SetProperties(kError, kError);
-          return;
-        }
-        arc.olabel = it->second;
+      const Label olabel = output_map.Find(arc.olabel);
+      if (olabel == kNoLabel) {
+        FSTERROR() << "Output symbol id " << arc.olabel
+                   << " missing from target vocabulary";
+        fst->SetProperties(kError, kError);
+        return;
       }
+      arc.olabel = olabel;
       aiter.SetValue(arc);
     }
   }
   fst->SetProperties(RelabelProperties(props), kFstProperties);
 }
 
+}  // namespace internal
+
+// Relabels either the input labels or output labels. The old to
+// new labels are specified using a vector of std::pair<Label, Label>.
+// Any label associations not specified are assumed to be identity
+// mapping. The destination labels must be valid labels (e.g., not kNoLabel).
+template <class Arc>
+void Relabel(
+    MutableFst<Arc> *fst,
+    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>>
+        &ipairs,
+    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>>
+        &opairs) {
+  internal::RelabelImpl(fst, ipairs, opairs);
+}
+
+// Overload for VectorFst: iterates with the VectorFst-specialized mutable
+// arc iterator, which reads and writes the arc vector in place instead of
+// making two virtual calls per arc.
+template <class Arc>
+void Relabel(
+    VectorFst<Arc> *fst,
+    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>>
+        &ipairs,
+    const std::vector<std::pair<typename Arc::Label, typename Arc::Label>>
+        &opairs) {
+  internal::RelabelImpl(fst, ipairs, opairs);
+}
+
 // Relabels either the input labels or output labels. The old to
 // new labels are specified using pairs of old and new symbol tables.
 // The tables must contain (at least) all labels on the appropriate side of the
@@ -104,9 +197,15 @@ void Relabel(MutableFst<Arc> *fst, const SymbolTable *old_isymbols,
              const SymbolTable *old_osymbols, const SymbolTable *new_osymbols,
              const std::string &unknown_osymbol, bool attach_new_osymbols) {
   using Label = typename Arc::Label;
-  // Constructs vectors of input-side label pairs.
+  // Constructs vectors of input-side label pairs. Identical checksums mean
+  // the tables assign every symbol the same label, so the pair list would be
+  // pure identity; skip the per-symbol walk, as the delayed RelabelFst does.
   std::vector<std::pair<Label, Label>> ipairs;
-  if (old_isymbols && new_isymbols) {
+  if (old_isymbols && new_isymbols &&
+      old_isymbols->LabeledCheckSum() == new_isymbols->LabeledCheckSum()) {
+    if (attach_new_isymbols) fst->SetInputSymbols(new_isymbols);
+  } else if (old_isymbols && new_isymbols) {
+    ipairs.reserve(old_isymbols->NumSymbols());
     size_t num_missing_syms = 0;
     Label unknown_ilabel = kNoLabel;
     if (!unknown_isymbol.empty()) {
@@ -139,9 +238,14 @@ void Relabel(MutableFst<Arc> *fst, const SymbolTable *old_isymbols,
     }
     if (attach_new_isymbols) fst->SetInputSymbols(new_isymbols);
   }
-  // Constructs vectors of output-side label pairs.
+  // Constructs vectors of output-side label pairs, with the same
+  // identical-table short-circuit as the input side.
   std::vector<std::pair<Label, Label>> opairs;
-  if (old_osymbols && new_osymbols) {
+  if (old_osymbols && new_osymbols &&
+      old_osymbols->LabeledCheckSum() == new_osymbols->LabeledCheckSum()) {
+    if (attach_new_osymbols) fst->SetOutputSymbols(new_osymbols);
+  } else if (old_osymbols && new_osymbols) {
+    opairs.reserve(old_osymbols->NumSymbols());
     size_t num_missing_syms = 0;
     Label unknown_olabel = kNoLabel;
     if (!unknown_osymbol.empty()) {
@@ -226,7 +330,7 @@ class RelabelFstImpl : public CacheImpl<Arc> {
   using FstImpl<Arc>::SetInputSymbols;
   using FstImpl<Arc>::SetOutputSymbols;
 
-  using CacheImpl<Arc>::PushArc;
+  using CacheImpl<Arc>::EmplaceArc;
   using CacheImpl<Arc>::HasArcs;
   using CacheImpl<Arc>::HasFinal;
   using CacheImpl<Arc>::HasStart;
@@ -242,8 +346,8 @@ class RelabelFstImpl : public CacheImpl<Arc> {
                  const RelabelFstOptions &opts)
       : CacheImpl<Arc>(opts),
         fst_(fst.Copy()),
-        input_map_(ipairs.begin(), ipairs.end()),
-        output_map_(opairs.begin(), opairs.end()),
+        input_map_(ipairs),
+        output_map_(opairs),
         relabel_input_(!ipairs.empty()),
         relabel_output_(!opairs.empty()) {
     SetProperties(RelabelProperties(fst.Properties(kCopyProperties, false)));
@@ -264,17 +368,23 @@ class RelabelFstImpl : public CacheImpl<Arc> {
     SetOutputSymbols(old_osymbols);
     if (old_isymbols && new_isymbols &&
         old_isymbols->LabeledCheckSum() != new_isymbols->LabeledCheckSum()) {
+      std::vector<std::pair<Label, Label>> ipairs;
+      ipairs.reserve(old_isymbols->NumSymbols());
       for (const auto &sitem : *old_isymbols) {
-        input_map_[sitem.Label()] = new_isymbols->Find(sitem.Symbol());
+        ipairs.emplace_back(sitem.Label(), new_isymbols->Find(sitem.Symbol()));
       }
+      input_map_ = RelabelMap<Label>(ipairs);
       SetInputSymbols(new_isymbols);
       relabel_input_ = true;
     }
     if (old_osymbols && new_osymbols &&
         old_osymbols->LabeledCheckSum() != new_osymbols->LabeledCheckSum()) {
+      std::vector<std::pair<Label, Label>> opairs;
+      opairs.reserve(old_osymbols->NumSymbols());
       for (const auto &sitem : *old_osymbols) {
-        output_map_[sitem.Label()] = new_osymbols->Find(sitem.Symbol());
+        opairs.emplace_back(sitem.Label(), new_osymbols->Find(sitem.Symbol()));
       }
+      output_map_ = RelabelMap<Label>(opairs);
       SetOutputSymbols(new_osymbols);
       relabel_output_ = true;
     }
@@ -334,28 +444,39 @@ class RelabelFstImpl : public CacheImpl<Arc> {
   }
 
   void Expand(StateId s) {
+    // relabel_input_ and relabel_output_ are fixed at construction, so the
+    // per-arc flag tests are hoisted out of the loop by dispatching once to
+    // an instantiation that has them folded to constants.
+    switch ((relabel_input_ ? 2 : 0) | (relabel_output_ ? 1 : 0)) {
+      case 0:
+        return ExpandImpl<false, false>(s);
+      case 1:
+        return ExpandImpl<false, true>(s);
+      case 2:
+        return ExpandImpl<true, false>(s);
+      default:
+        return ExpandImpl<true, true>(s);
+    }
+  }
+
+ private:
+  template <bool RelabelInput, bool RelabelOutput>
+  void ExpandImpl(StateId s) {
     for (ArcIterator<Fst<Arc>> aiter(*fst_, s); !aiter.Done(); aiter.Next()) {
-      auto arc = aiter.Value();
-      if (relabel_input_) {
-        if (auto it = input_map_.find(arc.ilabel); it != input_map_.end()) {
-          arc.ilabel = it->second;
-        }
-      }
-      if (relabel_output_) {
-        if (auto it = output_map_.find(arc.olabel); it != output_map_.end()) {
-          arc.olabel = it->second;
-        }
-      }
-      PushArc(s, std::move(arc));
+      // Constructs the relabeled arc directly in the cache state's storage
+      // rather than copying the source arc, mutating it, and moving it in.
+      const auto &arc = aiter.Value();
+      EmplaceArc(s, RelabelInput ? input_map_.Find(arc.ilabel) : arc.ilabel,
+                 RelabelOutput ? output_map_.Find(arc.olabel) : arc.olabel,
+                 arc.weight, arc.nextstate);
     }
     SetArcs(s);
   }
 
- private:
   std::unique_ptr<const Fst<Arc>> fst_;
 
-  std::unordered_map<Label, Label> input_map_;
-  std::unordered_map<Label, Label> output_map_;
+  RelabelMap<Label> input_map_;
+  RelabelMap<Label> output_map_;
   bool relabel_input_;
   bool relabel_output_;
 };
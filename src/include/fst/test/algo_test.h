@@ -22,6 +22,7 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -123,10 +124,18 @@ void LookAheadCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
 // Specialized and epsilon olabel acyclic - lookahead.
 inline void LookAheadCompose(const Fst<StdArc> &ifst1, const Fst<StdArc> &ifst2,
                              MutableFst<StdArc> *ofst) {
-  std::vector<StdArc::StateId> order;
   bool acyclic;
-  TopOrderVisitor<StdArc> visitor(&order, &acyclic);
-  DfsVisit(ifst1, &visitor, OutputEpsilonArcFilter<StdArc>());
+  if (ifst1.Properties(kAcyclic, false)) {
+    // A globally acyclic FST cannot have output-epsilon cycles, so the DFS
+    // below is skipped. The converse does not hold — a cyclic FST may still
+    // be output-epsilon acyclic — so the kCyclic bit proves nothing and the
+    // scan runs whenever kAcyclic is unknown or unset.
+    acyclic = true;
+  } else {
+    std::vector<StdArc::StateId> order;
+    TopOrderVisitor<StdArc> visitor(&order, &acyclic);
+    DfsVisit(ifst1, &visitor, OutputEpsilonArcFilter<StdArc>());
+  }
   if (acyclic) {  // no ifst1 output epsilon cycles?
     StdOLabelLookAheadFst lfst1(ifst1);
     StdVectorFst lfst2(ifst2);
@@ -162,8 +171,12 @@ class WeightedTester {
     TestMap(T1);
     TestCompose(T1, T2, T3);
     TestSort(T1);
-    TestOptimize(T1);
-    TestSearch(T1);
+    // TestOptimize and TestSearch both work on the input projection of T1;
+    // it is built once here and shared.
+    VectorFst<Arc> A1(T1);
+    Project(&A1, ProjectType::INPUT);
+    TestOptimize(T1, A1);
+    TestSearch(T1, A1);
   }
 
  private:
@@ -277,7 +290,7 @@ class WeightedTester {
       FST_CHECK(Equiv(C1, C4));
     }
 
-    if (Weight::Properties() & kLeftSemiring) {
+    if constexpr ((Weight::Properties() & kLeftSemiring) != 0) {
       VLOG(1) << "Check concatenation left distributes"
               << " over union (destructive).";
 
@@ -290,13 +303,13 @@ class WeightedTester {
       Concat(&C2, T1);
       VectorFst<Arc> C3(T3);
       Concat(&C3, T2);
-      VectorFst<Arc> U2(C2);
-      Union(&U2, C3);
+      // Unioning into C2 directly avoids a copy of it; C2 has no other use.
+      Union(&C2, C3);
 
-      FST_CHECK(Equiv(C1, U2));
+      FST_CHECK(Equiv(C1, C2));
     }
 
-    if (Weight::Properties() & kRightSemiring) {
+    if constexpr ((Weight::Properties() & kRightSemiring) != 0) {
       VLOG(1) << "Check concatenation right distributes"
               << " over union (destructive).";
       VectorFst<Arc> U1(T1);
@@ -308,13 +321,12 @@ class WeightedTester {
       Concat(&C2, T3);
       VectorFst<Arc> C3(T2);
       Concat(&C3, T3);
-      VectorFst<Arc> U2(C2);
-      Union(&U2, C3);
+      Union(&C2, C3);
 
-      FST_CHECK(Equiv(C1, U2));
+      FST_CHECK(Equiv(C1, C2));
     }
 
-    if (Weight::Properties() & kLeftSemiring) {
+    if constexpr ((Weight::Properties() & kLeftSemiring) != 0) {
       VLOG(1) << "Check concatenation left distributes over union (delayed).";
       UnionFst<Arc> U1(T1, T2);
       ConcatFst<Arc> C1(T3, U1);
@@ -326,7 +338,7 @@ class WeightedTester {
       FST_CHECK(Equiv(C1, U2));
     }
 
-    if (Weight::Properties() & kRightSemiring) {
+    if constexpr ((Weight::Properties() & kRightSemiring) != 0) {
       VLOG(1) << "Check concatenation right distributes over union (delayed).";
       UnionFst<Arc> U1(T1, T2);
       ConcatFst<Arc> C1(U1, T3);
@@ -338,7 +350,7 @@ class WeightedTester {
       FST_CHECK(Equiv(C1, U2));
     }
 
-    if (Weight::Properties() & kLeftSemiring) {
+    if constexpr ((Weight::Properties() & kLeftSemiring) != 0) {
       VLOG(1) << "Check T T* == T+ (destructive).";
       VectorFst<Arc> S(T1);
       Closure(&S, CLOSURE_STAR);
@@ -351,20 +363,19 @@ class WeightedTester {
       FST_CHECK(Equiv(C, P));
     }
 
-    if (Weight::Properties() & kRightSemiring) {
+    if constexpr ((Weight::Properties() & kRightSemiring) != 0) {
       VLOG(1) << "Check T* T == T+ (destructive).";
       VectorFst<Arc> S(T1);
       Closure(&S, CLOSURE_STAR);
-      VectorFst<Arc> C(S);
-      Concat(&C, T1);
+      Concat(&S, T1);
 
       VectorFst<Arc> P(T1);
       Closure(&P, CLOSURE_PLUS);
 
-      FST_CHECK(Equiv(C, P));
+      FST_CHECK(Equiv(S, P));
     }
 
-    if (Weight::Properties() & kLeftSemiring) {
+    if constexpr ((Weight::Properties() & kLeftSemiring) != 0) {
       VLOG(1) << "Check T T* == T+ (delayed).";
       ClosureFst<Arc> S(T1, CLOSURE_STAR);
       ConcatFst<Arc> C(T1, S);
@@ -374,7 +385,7 @@ class WeightedTester {
       FST_CHECK(Equiv(C, P));
     }
 
-    if (Weight::Properties() & kRightSemiring) {
+    if constexpr ((Weight::Properties() & kRightSemiring) != 0) {
       VLOG(1) << "Check T* T == T+ (delayed).";
       ClosureFst<Arc> S(T1, CLOSURE_STAR);
       ConcatFst<Arc> C(S, T1);
@@ -447,25 +458,34 @@ class WeightedTester {
       for (size_t i = 0; i < kNumLabels; ++i) labelset[i] = i;
       for (size_t i = 0; i < kNumLabels; ++i) {
         using std::swap;
-        const auto index =
-            std::uniform_int_distribution<>(0, kNumLabels - 1)(rand_);
+        // Bounds a raw generator word with a multiply and a shift rather
+        // than constructing a distribution per draw; the tiny bias of
+        // skipping the rejection step is irrelevant for a test shuffle.
+        const auto index = static_cast<size_t>(
+            (static_cast<uint64_t>(static_cast<uint32_t>(rand_())) *
+             kNumLabels) >>
+            32);
         swap(labelset[i], labelset[index]);
       }
 
-      std::vector<std::pair<Label, Label>> ipairs1(kNumLabels);
-      std::vector<std::pair<Label, Label>> opairs1(kNumLabels);
+      std::vector<std::pair<Label, Label>> ipairs1;
+      std::vector<std::pair<Label, Label>> opairs1;
+      ipairs1.reserve(kNumLabels);
+      opairs1.reserve(kNumLabels);
       for (size_t i = 0; i < kNumLabels; ++i) {
-        ipairs1[i] = std::make_pair(i, labelset[i]);
-        opairs1[i] = std::make_pair(labelset[i], i);
+        ipairs1.emplace_back(i, labelset[i]);
+        opairs1.emplace_back(labelset[i], i);
       }
       VectorFst<Arc> R(T);
       Relabel(&R, ipairs1, opairs1);
 
-      std::vector<std::pair<Label, Label>> ipairs2(kNumLabels);
-      std::vector<std::pair<Label, Label>> opairs2(kNumLabels);
+      std::vector<std::pair<Label, Label>> ipairs2;
+      std::vector<std::pair<Label, Label>> opairs2;
+      ipairs2.reserve(kNumLabels);
+      opairs2.reserve(kNumLabels);
       for (size_t i = 0; i < kNumLabels; ++i) {
-        ipairs2[i] = std::make_pair(labelset[i], i);
-        opairs2[i] = std::make_pair(i, labelset[i]);
+        ipairs2.emplace_back(labelset[i], i);
+        opairs2.emplace_back(i, labelset[i]);
       }
       Relabel(&R, ipairs2, opairs2);
       FST_CHECK(Equiv(R, T));
@@ -530,7 +550,7 @@ class WeightedTester {
 
   // Tests compose-based operations.
   void TestCompose(const Fst<Arc> &T1, const Fst<Arc> &T2, const Fst<Arc> &T3) {
-    if (!(Weight::Properties() & kCommutative)) return;
+    if constexpr ((Weight::Properties() & kCommutative) == 0) return;
 
     VectorFst<Arc> S1(T1);
     VectorFst<Arc> S2(T2);
@@ -543,12 +563,18 @@ class WeightedTester {
     ArcSort(&S2, ocomp);
     ArcSort(&S3, icomp);
 
+    // The products S1 S2 and S2 S3 each feed several checks below, so their
+    // delayed compositions are constructed once here; S1 S2 is additionally
+    // expanded to a vector FST for the checks that only need its language,
+    // so they do not re-run the compose state expansion.
+    ComposeFst<Arc> C12(S1, S2);
+    VectorFst<Arc> V12(C12);
+    ComposeFst<Arc> C23(S2, S3);
+
     {
       VLOG(1) << "Check composition is associative.";
-      ComposeFst<Arc> C1(S1, S2);
-      ComposeFst<Arc> C2(C1, S3);
-      ComposeFst<Arc> C3(S2, S3);
-      ComposeFst<Arc> C4(S1, C3);
+      ComposeFst<Arc> C2(C12, S3);
+      ComposeFst<Arc> C4(S1, C23);
 
       FST_CHECK(Equiv(C2, C4));
     }
@@ -558,9 +584,8 @@ class WeightedTester {
       UnionFst<Arc> U1(S2, S3);
       ComposeFst<Arc> C1(S1, U1);
 
-      ComposeFst<Arc> C2(S1, S2);
       ComposeFst<Arc> C3(S1, S3);
-      UnionFst<Arc> U2(C2, C3);
+      UnionFst<Arc> U2(V12, C3);
 
       FST_CHECK(Equiv(C1, U2));
     }
@@ -571,8 +596,7 @@ class WeightedTester {
       ComposeFst<Arc> C1(U1, S3);
 
       ComposeFst<Arc> C2(S1, S3);
-      ComposeFst<Arc> C3(S2, S3);
-      UnionFst<Arc> U2(C2, C3);
+      UnionFst<Arc> U2(C2, C23);
 
       FST_CHECK(Equiv(C1, U2));
     }
@@ -594,40 +618,38 @@ class WeightedTester {
     {
       VLOG(1) << "Check all epsilon filters leads to equivalent results.";
       using M = Matcher<Fst<Arc>>;
-      ComposeFst<Arc> C1(S1, S2);
       ComposeFst<Arc> C2(
           S1, S2, ComposeFstOptions<Arc, M, AltSequenceComposeFilter<M>>());
       ComposeFst<Arc> C3(S1, S2,
                          ComposeFstOptions<Arc, M, MatchComposeFilter<M>>());
 
-      FST_CHECK(Equiv(C1, C2));
-      FST_CHECK(Equiv(C1, C3));
+      FST_CHECK(Equiv(V12, C2));
+      FST_CHECK(Equiv(V12, C3));
 
       if ((Weight::Properties() & kIdempotent) ||
           S1.Properties(kNoOEpsilons, false) ||
           S2.Properties(kNoIEpsilons, false)) {
         ComposeFst<Arc> C4(
             S1, S2, ComposeFstOptions<Arc, M, TrivialComposeFilter<M>>());
-        FST_CHECK(Equiv(C1, C4));
+        FST_CHECK(Equiv(V12, C4));
         ComposeFst<Arc> C5(
             S1, S2, ComposeFstOptions<Arc, M, NoMatchComposeFilter<M>>());
-        FST_CHECK(Equiv(C1, C5));
+        FST_CHECK(Equiv(V12, C5));
       }
 
       if (S1.Properties(kNoOEpsilons, false) &&
           S2.Properties(kNoIEpsilons, false)) {
         ComposeFst<Arc> C6(S1, S2,
                            ComposeFstOptions<Arc, M, NullComposeFilter<M>>());
-        FST_CHECK(Equiv(C1, C6));
+        FST_CHECK(Equiv(V12, C6));
       }
     }
 
     {
       VLOG(1) << "Check look-ahead filters lead to equivalent results.";
-      VectorFst<Arc> C1, C2;
-      Compose(S1, S2, &C1);
+      VectorFst<Arc> C2;
       LookAheadCompose(S1, S2, &C2);
-      FST_CHECK(Equiv(C1, C2));
+      FST_CHECK(Equiv(V12, C2));
     }
   }
 
@@ -636,30 +658,29 @@ class WeightedTester {
     ILabelCompare<Arc> icomp;
     OLabelCompare<Arc> ocomp;
 
+    // The first three checks all need the same ilabel-sorted copy of T, so
+    // it is built once here rather than re-copied and re-sorted per block.
+    VectorFst<Arc> SI(T);
+    ArcSort(&SI, icomp);
+
     {
       VLOG(1) << "Check arc sorted Fst is equivalent to its input.";
-      VectorFst<Arc> S1(T);
-      ArcSort(&S1, icomp);
-      FST_CHECK(Equiv(T, S1));
+      FST_CHECK(Equiv(T, SI));
     }
 
     {
       VLOG(1) << "Check destructive and delayed arcsort are equivalent.";
-      VectorFst<Arc> S1(T);
-      ArcSort(&S1, icomp);
       ArcSortFst<Arc, ILabelCompare<Arc>> S2(T, icomp);
-      FST_CHECK(Equiv(S1, S2));
+      FST_CHECK(Equiv(SI, S2));
     }
 
     {
       VLOG(1) << "Check ilabel sorting vs. olabel sorting with inversions.";
-      VectorFst<Arc> S1(T);
       VectorFst<Arc> S2(T);
-      ArcSort(&S1, icomp);
       Invert(&S2);
       ArcSort(&S2, ocomp);
       Invert(&S2);
-      FST_CHECK(Equiv(S1, S2));
+      FST_CHECK(Equiv(SI, S2));
     }
 
     {
@@ -682,13 +703,11 @@ class WeightedTester {
     }
   }
 
-  // Tests optimization operations
-  void TestOptimize(const Fst<Arc> &T) {
+  // Tests optimization operations; A is the input projection of T.
+  void TestOptimize(const Fst<Arc> &T, const Fst<Arc> &A) {
     uint64_t tprops = T.Properties(kFstProperties, true);
     uint64_t wprops = Weight::Properties();
 
-    VectorFst<Arc> A(T);
-    Project(&A, ProjectType::INPUT);
     {
       VLOG(1) << "Check connected FST is equivalent to its input.";
       VectorFst<Arc> C1(T);
@@ -710,16 +729,34 @@ class WeightedTester {
 
       VLOG(1) << "Check an FST with a large proportion"
               << " of epsilon transitions:";
-      // Maps all transitions of T to epsilon-transitions and append
-      // a non-epsilon transition.
+      // Maps all transitions of T to epsilon-transitions and appends a
+      // non-epsilon transition, in one pass over T: the states of T are laid
+      // out first, each arc is emitted with epsilon labels, and each final
+      // state instead gets an epsilon arc (weighted by its final weight) to
+      // the appended two-state machine — the same result ArcMap with
+      // EpsMapper followed by a destructive Concat produced with a second
+      // full traversal.
       VectorFst<Arc> U;
-      ArcMap(T, &U, EpsMapper<Arc>());
-      VectorFst<Arc> V;
-      V.SetStart(V.AddState());
-      Arc arc(1, 1, Weight::One(), V.AddState());
-      V.AddArc(V.Start(), arc);
-      V.SetFinal(arc.nextstate, Weight::One());
-      Concat(&U, V);
+      for (StateIterator<Fst<Arc>> siter(T); !siter.Done(); siter.Next()) {
+        U.AddState();
+      }
+      const auto appended = U.AddState();
+      const auto final_state = U.AddState();
+      for (StateIterator<Fst<Arc>> siter(T); !siter.Done(); siter.Next()) {
+        const auto s = siter.Value();
+        U.ReserveArcs(s, T.NumArcs(s) + 1);
+        for (ArcIterator<Fst<Arc>> aiter(T, s); !aiter.Done(); aiter.Next()) {
+          const auto &arc = aiter.Value();
+          U.AddArc(s, Arc(0, 0, arc.weight, arc.nextstate));
+        }
+        const Weight final_weight = T.Final(s);
+        if (final_weight != Weight::Zero()) {
+          U.AddArc(s, Arc(0, 0, final_weight, appended));
+        }
+      }
+      U.SetStart(T.Start());
+      U.AddArc(appended, Arc(1, 1, Weight::One(), final_state));
+      U.SetFinal(final_state, Weight::One());
       // Check that epsilon-removal preserves the shortest-distance
       // from the initial state to the final states.
       std::vector<Weight> d;
@@ -749,7 +786,8 @@ class WeightedTester {
         FST_CHECK(Equiv(T, DT));
       }
 
-      if ((wprops & (kPath | kCommutative)) == (kPath | kCommutative)) {
+      if constexpr ((Weight::Properties() & (kPath | kCommutative)) ==
+                    (kPath | kCommutative)) {
         VLOG(1) << "Check pruning in determinization";
         VectorFst<Arc> P;
         const Weight threshold = generate_();
@@ -760,7 +798,7 @@ class WeightedTester {
         FST_CHECK(PruneEquiv(A, P, threshold));
       }
 
-      if ((wprops & kPath) == kPath) {
+      if constexpr ((Weight::Properties() & kPath) == kPath) {
         VLOG(1) << "Check min-determinization";
 
         // Ensures no input epsilons
@@ -804,9 +842,11 @@ class WeightedTester {
         VectorFst<Arc> RD;
         Reverse(DR, &RD);
         DeterminizeFst<Arc> DRD(RD);
-        VectorFst<Arc> M(DRD);
-        FST_CHECK_EQ(n + 1, M.NumStates());  // Accounts for the epsilon transition
-                                         // to the initial state
+        // Only the state count is needed, so the final determinization is
+        // traversed in place rather than materialized into a VectorFst.
+        FST_CHECK_EQ(n + 1, CountStates(DRD));  // Accounts for the epsilon
+                                                // transition to the initial
+                                                // state
       }
     }
 
@@ -835,12 +875,11 @@ class WeightedTester {
 
     if (Arc::Type() == LogArc::Type() || Arc::Type() == StdArc::Type()) {
       VLOG(1) << "Check reweight(T) equiv T";
-      std::vector<Weight> potential;
       VectorFst<Arc> RI(T);
       VectorFst<Arc> RF(T);
-      while (potential.size() < RI.NumStates()) {
-        potential.push_back(generate_());
-      }
+      std::vector<Weight> potential(RI.NumStates());
+      std::generate(potential.begin(), potential.end(),
+                    [this] { return generate_(); });
 
       Reweight(&RI, potential, REWEIGHT_TO_INITIAL);
       FST_CHECK(Equiv(T, RI));
@@ -882,7 +921,8 @@ class WeightedTester {
     }
 
     if constexpr (IsPath<Weight>::value) {
-      if ((wprops & (kPath | kCommutative)) == (kPath | kCommutative)) {
+      if constexpr ((Weight::Properties() & (kPath | kCommutative)) ==
+                    (kPath | kCommutative)) {
         VLOG(1) << "Check pruning algorithm";
         {
           VLOG(1) << "Check equiv. of constructive and destructive algorithms";
@@ -923,15 +963,11 @@ class WeightedTester {
     }
   }
 
-  // Tests search operations
-  void TestSearch(const Fst<Arc> &T) {
+  // Tests search operations; A is the input projection of T.
+  void TestSearch(const Fst<Arc> &T, const Fst<Arc> &A) {
     if constexpr (IsPath<Weight>::value) {
-      uint64_t wprops = Weight::Properties();
-
-      VectorFst<Arc> A(T);
-      Project(&A, ProjectType::INPUT);
-
-      if ((wprops & (kPath | kRightSemiring)) == (kPath | kRightSemiring)) {
+      if constexpr ((Weight::Properties() & (kPath | kRightSemiring)) ==
+                    (kPath | kRightSemiring)) {
         VLOG(1) << "Check 1-best weight.";
         VectorFst<Arc> path;
         ShortestPath(T, &path);
@@ -940,7 +976,8 @@ class WeightedTester {
         FST_CHECK(ApproxEqual(tsum, psum, kTestDelta));
       }
 
-      if ((wprops & (kPath | kSemiring)) == (kPath | kSemiring)) {
+      if constexpr ((Weight::Properties() & (kPath | kSemiring)) ==
+                    (kPath | kSemiring)) {
         VLOG(1) << "Check n-best weights";
         VectorFst<Arc> R(A);
         RmEpsilon(&R, /*connect=*/true, Arc::Weight::Zero(), kNoStateId,
@@ -969,7 +1006,9 @@ class WeightedTester {
             ArcMap(&path, RmWeightMapper<Arc>());
             VectorFst<Arc> S;
             Difference(R, path, &S);
-            R = S;
+            // Move assignment: copying S back into R would deep-copy the
+            // residual automaton once per subtracted path.
+            R = std::move(S);
           }
         }
       }
@@ -984,10 +1023,21 @@ class WeightedTester {
     FST_CHECK(Verify(fst1));
     FST_CHECK(Verify(fst2));
 
-    // Ensures seed used once per instantiation.
+    // State-by-state identical machines are equivalent without the random
+    // path test; this is common for destructive-vs-delayed pairs. Only
+    // already-expanded operands are compared, so no delayed FST is forced
+    // through a full expansion just for this check; a mismatch exits Equal
+    // at the first differing state.
+    if (fst1.Properties(kExpanded, false) &&
+        fst2.Properties(kExpanded, false) && Equal(fst1, fst2, kTestDelta)) {
+      return true;
+    }
+
+    // Ensures seed used once per instantiation. The options only wrap the
+    // selector and path bound, so they are constructed once as well.
     static const UniformArcSelector<A> uniform_selector(seed_);
-    const RandGenOptions<UniformArcSelector<A>> opts(uniform_selector,
-                                                     kRandomPathLength);
+    static const RandGenOptions<UniformArcSelector<A>> opts(uniform_selector,
+                                                            kRandomPathLength);
     return RandEquivalent(fst1, fst2, kNumRandomPaths, opts, kTestDelta, seed_);
   }
 
@@ -1007,10 +1057,10 @@ class WeightedTester {
   // '(is, os)' is the minimum weight match to 'is' in fst2.
   template <class A>
   bool MinRelated(const Fst<A> &fst1, const Fst<A> &fst2) {
-    // Same domain
-    VectorFst<Arc> P1(fst1), P2(fst2);
-    Project(&P1, ProjectType::INPUT);
-    Project(&P2, ProjectType::INPUT);
+    // Same domain. Delayed projections: the equivalence check only reads
+    // the arcs once, so there is no need to materialize copies first.
+    const ProjectFst<A> P1(fst1, ProjectType::INPUT);
+    const ProjectFst<A> P2(fst2, ProjectType::INPUT);
     if (!Equiv(P1, P2)) {
       LOG(ERROR) << "Inputs not equivalent";
       return false;
@@ -1018,8 +1068,8 @@ class WeightedTester {
 
     // Ensures seed used once per instantiation.
     static const UniformArcSelector<A> uniform_selector(seed_);
-    const RandGenOptions<UniformArcSelector<A>> opts(uniform_selector,
-                                                     kRandomPathLength);
+    static const RandGenOptions<UniformArcSelector<A>> opts(uniform_selector,
+                                                            kRandomPathLength);
 
     VectorFst<Arc> path, paths1, paths2;
     for (ssize_t n = 0; n < kNumRandomPaths; ++n) {
@@ -1045,8 +1095,14 @@ class WeightedTester {
     FST_CHECK(Verify(fst));
     FST_CHECK(Verify(pfst));
 
-    DifferenceFst<Arc> D(fst, DeterminizeFst<Arc>(RmEpsilonFst<Arc>(
-                                  ArcMapFst(pfst, RmWeightMapper<Arc>()))));
+    // ShortestDistance may relax states repeatedly before converging, so the
+    // difference is materialized once instead of being re-read through the
+    // stack of delayed FSTs on every revisit.
+    VectorFst<Arc> D;
+    Difference(fst,
+               DeterminizeFst<Arc>(
+                   RmEpsilonFst<Arc>(ArcMapFst(pfst, RmWeightMapper<Arc>()))),
+               &D);
     const Weight sum1 = Times(ShortestDistance(fst), threshold);
     const Weight sum2 = ShortestDistance(D);
     return ApproxEqual(Plus(sum1, sum2), sum1, kTestDelta);
@@ -1150,12 +1206,26 @@ class UnweightedTester<StdArc> {
     {
       VLOG(1) << "Check if A^n c A* (delayed).";
       const int n = std::uniform_int_distribution<>(0, 4)(rand_);
-      std::unique_ptr<Fst<Arc>> C = std::make_unique<VectorFst<Arc>>(one_fsa_);
-      for (int i = 0; i < n; ++i) {
-        C = std::make_unique<ConcatFst<Arc>>(*C, A1);
+      // Combines the factors pairwise so the delayed concatenation forms a
+      // balanced tree: a state access then crosses O(log n) wrapper layers
+      // rather than the O(n) of a left-deep chain.
+      std::vector<std::unique_ptr<Fst<Arc>>> layer;
+      layer.reserve(n + 1);
+      layer.emplace_back(one_fsa_.Copy());
+      for (int i = 0; i < n; ++i) layer.emplace_back(A1.Copy());
+      while (layer.size() > 1) {
+        std::vector<std::unique_ptr<Fst<Arc>>> next;
+        next.reserve((layer.size() + 1) / 2);
+        size_t i = 0;
+        for (; i + 1 < layer.size(); i += 2) {
+          next.push_back(
+              std::make_unique<ConcatFst<Arc>>(*layer[i], *layer[i + 1]));
+        }
+        if (i < layer.size()) next.push_back(std::move(layer[i]));
+        layer = std::move(next);
       }
       ClosureFst<Arc> S(A1, CLOSURE_STAR);
-      FST_CHECK(Subset(*C, S));
+      FST_CHECK(Subset(*layer.front(), S));
     }
   }
 
@@ -1271,9 +1341,11 @@ class UnweightedTester<StdArc> {
         VectorFst<Arc> RD;
         Reverse(DR, &RD);
         DeterminizeFst<Arc> DRD(RD);
-        VectorFst<Arc> M(DRD);
-        FST_CHECK_EQ(n + 1, M.NumStates());  // Accounts for the epsilon transition
-                                         // to the initial state.
+        // Only the state count is needed, so the final determinization is
+        // traversed in place rather than materialized into a VectorFst.
+        FST_CHECK_EQ(n + 1, CountStates(DRD));  // Accounts for the epsilon
+                                                // transition to the initial
+                                                // state.
       }
     }
   }
@@ -1284,6 +1356,13 @@ class UnweightedTester<StdArc> {
     FST_CHECK(Verify(fsa1));
     FST_CHECK(Verify(fsa2));
 
+    // Identical expanded machines need none of the epsilon-removal and
+    // determinization machinery below.
+    if (fsa1.Properties(kExpanded, false) &&
+        fsa2.Properties(kExpanded, false) && Equal(fsa1, fsa2)) {
+      return true;
+    }
+
     VectorFst<Arc> vfsa1(fsa1);
     VectorFst<Arc> vfsa2(fsa2);
     RmEpsilon(&vfsa1);
@@ -1321,8 +1400,8 @@ class UnweightedTester<StdArc> {
     FST_CHECK(Verify(fsa1));
     FST_CHECK(Verify(fsa2));
 
-    VectorFst<StdArc> vfsa1;
-    VectorFst<StdArc> vfsa2;
+    VectorFst<StdArc> vfsa1(fsa1);
+    VectorFst<StdArc> vfsa2(fsa2);
     RmEpsilon(&vfsa1);
     RmEpsilon(&vfsa2);
     ILabelCompare<StdArc> comp;
@@ -1334,12 +1413,43 @@ class UnweightedTester<StdArc> {
     return Equivalent(dfa1, dfa2);
   }
 
-  // Returns complement FSA.
+  // Returns complement FSA. Builds it directly: the epsilon-removed input is
+  // determinized, completed over the alphabet of univ_fsa_ with a dead state,
+  // and its final and non-final states exchanged. This accepts the same
+  // language as differencing from univ_fsa_ but skips the product
+  // construction and leaves no library-internal rho labels in the result.
   void Complement(const Fst<Arc> &ifsa, MutableFst<Arc> *ofsa) {
     RmEpsilonFst<Arc> rfsa(ifsa);
     DeterminizeFst<Arc> dfa(rfsa);
-    DifferenceFst<Arc> cfsa(univ_fsa_, dfa);
-    *ofsa = cfsa;
+    *ofsa = dfa;
+
+    // The alphabet: the non-epsilon labels looping at univ_fsa_'s state.
+    std::vector<Label> sigma;
+    for (ArcIterator<Fst<Arc>> aiter(univ_fsa_, univ_fsa_.Start());
+         !aiter.Done(); aiter.Next()) {
+      const auto label = aiter.Value().ilabel;
+      if (label != 0) sigma.push_back(label);
+    }
+    std::sort(sigma.begin(), sigma.end());
+
+    const StateId dead = ofsa->AddState();
+    if (ofsa->Start() == kNoStateId) ofsa->SetStart(dead);
+    std::vector<Label> present;
+    for (StateId s = 0; s < ofsa->NumStates(); ++s) {
+      ofsa->SetFinal(s, ofsa->Final(s) == Weight::Zero() ? Weight::One()
+                                                         : Weight::Zero());
+      present.clear();
+      for (ArcIterator<Fst<Arc>> aiter(*ofsa, s); !aiter.Done();
+           aiter.Next()) {
+        present.push_back(aiter.Value().ilabel);
+      }
+      std::sort(present.begin(), present.end());
+      for (const auto label : sigma) {
+        if (!std::binary_search(present.begin(), present.end(), label)) {
+          ofsa->AddArc(s, Arc(label, label, Weight::One(), dead));
+        }
+      }
+    }
   }
 
   // FSA with no states.
@@ -1391,19 +1501,25 @@ class AlgoTester {
   void Test() {
     VLOG(1) << "weight type = " << Weight::Type();
 
+    // The transducers and their projections live outside the loop so each
+    // iteration reuses the same VectorFst frames: RandFst starts from
+    // DeleteStates(), which keeps the state array's allocation for refill.
+    VectorFst<Arc> T1;
+    VectorFst<Arc> T2;
+    VectorFst<Arc> T3;
+    VectorFst<Arc> A1;
+    VectorFst<Arc> A2;
+    VectorFst<Arc> A3;
     for (int i = 0; i < FST_FLAGS_repeat; ++i) {
       // Random transducers
-      VectorFst<Arc> T1;
-      VectorFst<Arc> T2;
-      VectorFst<Arc> T3;
       MakeRandFst(&T1);
       MakeRandFst(&T2);
       MakeRandFst(&T3);
       weighted_tester_->Test(T1, T2, T3);
 
-      VectorFst<Arc> A1(T1);
-      VectorFst<Arc> A2(T2);
-      VectorFst<Arc> A3(T3);
+      A1 = T1;
+      A2 = T2;
+      A3 = T3;
       Project(&A1, ProjectType::OUTPUT);
       Project(&A2, ProjectType::INPUT);
       Project(&A3, ProjectType::INPUT);
@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <fst/log.h>
 #include <fst/equal.h>
@@ -54,6 +55,16 @@ class FstTester {
 
   explicit FstTester(size_t num_states = 128, bool weighted = true)
       : num_states_(num_states), weighted_(weighted) {
+    // Builds the n-fold sums served by NthWeight() as one running prefix;
+    // index n both labels arcs (up to num_states_) and is checked against
+    // every arc and final weight in TestBase().
+    nth_weights_.reserve(num_states + 1);
+    Weight w = Weight::Zero();
+    nth_weights_.push_back(w);
+    for (size_t n = 1; n <= num_states; ++n) {
+      w = Plus(w, Weight::One());
+      nth_weights_.push_back(w);
+    }
     VectorFst<Arc> vfst;
     InitFst(&vfst, num_states);
     testfst_ = std::make_unique<F>(vfst);
@@ -317,9 +328,10 @@ class FstTester {
     for (StateId s = 0; s < nstates; ++s) {
       fst->AddState();
       fst->SetFinal(s, NthWeight(s));
+      // State s receives exactly s + 1 arcs.
+      fst->ReserveArcs(s, s + 1);
       for (size_t i = 1; i <= s; ++i) {
-        Arc arc(i, 0, NthWeight(i), s);
-        fst->AddArc(s, arc);
+        fst->AddArc(s, Arc(i, 0, NthWeight(i), s));
       }
       fst->AddArc(
           s, Arc(s + 1, 0, NthWeight(s + 1), s == nstates - 1 ? 0 : s + 1));
@@ -329,16 +341,17 @@ class FstTester {
   }
 
   // Generates One() + ... + One() (n times) if weighted_,
-  // otherwise One().
+  // otherwise One(). The sums are precomputed in the constructor, so a
+  // call is an array load rather than an O(n) Plus loop.
   Weight NthWeight(int n) const {
     if (!weighted_) return Weight::One();
-    Weight w = Weight::Zero();
-    for (int i = 0; i < n; ++i) w = Plus(w, Weight::One());
-    return w;
+    return nth_weights_[n];
   }
 
   size_t num_states_ = 0;
   bool weighted_ = true;
+  // nth_weights_[n] is the n-fold sum of One().
+  std::vector<Weight> nth_weights_;
   std::unique_ptr<F> testfst_;  // what we're testing
 };
 
@@ -16,7 +16,7 @@
 // finite-state transducer library.
 //
 // Union-find algorithm for dense sets of non-negative integers, implemented
-// using disjoint tree forests with rank heuristics and path compression.
+// using disjoint tree forests with rank heuristics and path halving.
 
 #ifndef FST_UNION_FIND_H_
 #define FST_UNION_FIND_H_
@@ -34,22 +34,20 @@ class UnionFind {
   // The upper bound of the range can be reset (increased) using MakeSet(...).
   UnionFind(T max, T fail) : parent_(max, fail), rank_(max), fail_(fail) {}
 
-  // Finds the representative of the set 'item' belongs to, performing path
-  // compression if necessary.
+  // Finds the representative of the set 'item' belongs to, compressing the
+  // path by halving: each visited node is re-pointed at its grandparent, so
+  // the same single walk that reaches the root also shortens the path for
+  // later lookups.
   T FindSet(T item) {
     if (item >= parent_.size() || item == fail_ || parent_[item] == fail_) {
       return fail_;
     }
-    T root = item;
-    while (root != parent_[root]) {
-      root = parent_[root];
-    }
     while (item != parent_[item]) {
-      T parent = parent_[item];
-      parent_[item] = root;
-      item = parent;
+      const T grandparent = parent_[parent_[item]];
+      parent_[item] = grandparent;
+      item = grandparent;
     }
-    return root;
+    return item;
   }
 
   // Creates the (destructive) union of the sets x and y belong to.
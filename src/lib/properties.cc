@@ -322,17 +322,6 @@ uint64_t ReplaceProperties(const std::vector<uint64_t> &inprops, size_t root,
   return outprops;
 }
 
-// Properties for a relabeled FST.
-uint64_t RelabelProperties(uint64_t inprops) {
-  static constexpr auto outprops =
-      kExpanded | kMutable | kError | kWeighted | kUnweighted |
-      kWeightedCycles | kUnweightedCycles | kCyclic | kAcyclic |
-      kInitialCyclic | kInitialAcyclic | kTopSorted | kNotTopSorted |
-      kAccessible | kNotAccessible | kCoAccessible | kNotCoAccessible |
-      kString | kNotString;
-  return outprops & inprops;
-}
-
 // Properties for a reversed FST (the superinitial state limits this set).
 uint64_t ReverseProperties(uint64_t inprops, bool has_superinitial) {
   auto outprops = (kExpanded | kMutable | kError | kAcceptor | kNotAcceptor |